@@ -5,9 +5,37 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <unordered_map>
 #include <algorithm>
 #include <cctype>
 #include <limits>
+#include <functional>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <cerrno>
+#include <csignal>
+#include <queue>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <memory>
+#include <tuple>
+#include <dirent.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
 
 using namespace std;
 
@@ -16,12 +44,30 @@ using namespace std;
 namespace Payroll {
     const double TAX_FREE_ALLOWANCE = 12570.0;  // UK tax-free allowance
     const double TAX_RATE = 0.20;               // 20% tax rate
+    const double HIGHER_TAX_RATE = 0.40;        // Statutory higher rate, for D0 codes
+    const double ADDITIONAL_TAX_RATE = 0.45;    // Statutory additional rate, for D1 codes
     const int MONTHS_IN_YEAR = 12;
+    const int TAX_YEAR_START_MONTH = 3;                  // April, as a zero-based month index
+    const double TAX_CODE_UNIT = 10.0;                   // Pounds of allowance per tax code number
+    const double TAX_CODE_ROUNDING = 9.0;                // Added to a nonzero code's allowance
     const int SORT_HOURLY_RATE = 1;
     const int SORT_HOURS_WORKED = 2;
     const int SORT_NET_PAY = 3;
     const int FILE_CHOICE_SAME = 1;
     const int FILE_CHOICE_NEW = 2;
+    const size_t SORT_MEMORY_BUDGET = 64 * 1024 * 1024;  // Bytes held in memory while ranking
+    const size_t PIPELINE_QUEUE_DEPTH = 2;               // Months buffered between pipeline stages
+    const size_t PARALLEL_WRITE_MIN_ROWS = 20000;        // Smaller reports are written serially
+    const int WATCH_DEBOUNCE_MS = 2000;                  // Quiet time before a landed file is processed
+    const uintmax_t BACKGROUND_LOAD_MIN_BYTES = 8 * 1024 * 1024;  // Larger pay files load in the background
+    const int PROGRESS_REFRESH_MS = 500;                 // Progress line refresh interval
+    const size_t COMPRESS_BLOCK_BYTES = 4 * 1024 * 1024; // Report bytes per parallel compression block
+    const size_t AGGREGATE_SLICE_RECORDS = 65536;        // Minimum pay records per aggregation worker
+    const size_t PICKER_PAGE_SIZE = 20;                  // Employees listed per picker page
+    const size_t MAX_QUERY_CONNECTIONS = 64;             // Query connections served at once
+    const int ACCEPT_RETRY_MS = 100;                     // Wait before accepting again when out of descriptors
+    const int ID_SUGGESTION_MAX_EDITS = 2;               // Furthest valid ID suggested for a bad one
+    const size_t ID_SUGGESTION_LIMIT = 3;                // Valid IDs suggested per bad one
 }
 
 // Menu option constants to avoid magic numbers
@@ -32,6 +78,8 @@ namespace Menu {
     const int VIEW_INDIVIDUAL = 3;
     const int SORT_EMPLOYEES = 4;
     const int VIEW_EMPLOYEE_TOTALS = 5;
+    const int LOAD_PROGRESS = 6;
+    const int RELOAD_EMPLOYEES = 7;
     const int INVALID_CHOICE = -1;
 }
 
@@ -44,11 +92,28 @@ namespace Limits {
 namespace FileNames {
     const string EMPLOYEES_FILE = "employees.txt";
     const string ERROR_LOG_FILE = "errors.txt";
+    const string MANIFEST_FILE = "processed_manifest.txt";
+    const string TAX_BANDS_FILE = "tax_bands.txt";
+    const string OVERTIME_RULES_FILE = "overtime_rules.txt";
     const string OUTPUT_SUFFIX = "_output.txt";
 }
 
 namespace FileExt {
     const string TXT = ".txt";
+    const string GZIP = ".gz";
+    const string ZSTD = ".zst";
+}
+
+// Command line options for non-interactive modes
+namespace Options {
+    const string WATCH = "--watch";
+    const string SERVE = "--serve";
+    const string COMPRESS_OUTPUT = "--compress-output";  // Followed by "gz" or "zst"
+    const string TO_BINARY = "--to-binary";              // Followed by text and binary pay file names
+    const string AGGREGATE_SHIFTS = "--aggregate-shifts";  // Sum repeated IDs instead of replacing
+    const string CUMULATIVE_PAYE = "--cumulative-paye";  // Tax year-to-date pay instead of each month alone
+    const string SHARDS = "--shards";                    // Followed by shard count and pay file names
+    const string SORT_BUDGET = "--sort-budget";          // Followed by bytes, optionally with K, M or G
 }
 
 // User input constants
@@ -56,6 +121,9 @@ namespace Inputs {
     const char YES = 'y';
     const char NO = 'n';
     const string RETURN = "0";
+    const string CANCEL = "c";
+    const string NEXT_PAGE = ">";
+    const string PREV_PAGE = "<";
 }
 
 const string CURRENCY = "£";
@@ -83,63 +151,1806 @@ string toLower(const string& s) {
     return out;
 }
 
+// Converts a month label (e.g., "JAN25") to a sortable period number
+// (year * 12 + month index), or -1 if it is not a calendar month
+int monthPeriod(const string& month) {
+    static const string MONTH_NAMES = "JANFEBMARAPRMAYJUNJULAUGSEPOCTNOVDEC";
+    if (month.size() != 5 || !isdigit(static_cast<unsigned char>(month[3])) ||
+        !isdigit(static_cast<unsigned char>(month[4])))
+        return -1;
+    size_t pos = MONTH_NAMES.find(toUpper(month.substr(0, 3)));
+    if (pos == string::npos || pos % 3 != 0) return -1;
+    int year = 2000 + (month[3] - '0') * 10 + (month[4] - '0');
+    return year * Payroll::MONTHS_IN_YEAR + static_cast<int>(pos / 3);
+}
+
+// Escapes a string for use inside a JSON string literal
+string jsonEscape(const string& s) {
+    string out;
+    out.reserve(s.size());
+    for (char c : s) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\t': out += "\\t"; break;
+            case '\r': out += "\\r"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char esc[8];
+                    snprintf(esc, sizeof(esc), "\\u%04x", c);
+                    out += esc;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    return out;
+}
+
+// Fast 64-bit content hash, eight bytes at a time. Data may be fed in
+// chunks of any size; the result is the same as hashing it in one piece.
+class StreamHasher {
+private:
+    static const uint64_t SEED = 0x9E3779B97F4A7C15ULL;
+    static const uint64_t MUL = 0xFF51AFD7ED558CCDULL;
+    uint64_t h = SEED;
+    char tail[8];
+    size_t tailLen = 0;
+
+    void mixWord(const char* p) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        h = (h ^ word) * MUL;
+        h ^= h >> 29;
+    }
+
+public:
+    void update(const char* data, size_t n) {
+        if (tailLen > 0) {
+            size_t take = min(8 - tailLen, n);
+            memcpy(tail + tailLen, data, take);
+            tailLen += take;
+            data += take;
+            n -= take;
+            if (tailLen < 8) return;
+            mixWord(tail);
+            tailLen = 0;
+        }
+        size_t full = n & ~size_t(7);
+        for (size_t i = 0; i < full; i += 8) mixWord(data + i);
+        tailLen = n - full;
+        memcpy(tail, data + full, tailLen);
+    }
+
+    uint64_t digest() const {
+        uint64_t r = h;
+        for (size_t i = 0; i < tailLen; ++i) r = (r ^ static_cast<unsigned char>(tail[i])) * MUL;
+        return r;
+    }
+};
+
+uint64_t hashBytes(const char* data, size_t n) {
+    StreamHasher hasher;
+    hasher.update(data, n);
+    return hasher.digest();
+}
+
+// =============== Input Files ===============
+// True if a file name ends with the given extension (case-insensitive)
+bool hasExtension(const string& filename, const string& ext) {
+    return filename.size() >= ext.size() && toLower(filename.substr(filename.size() - ext.size())) == ext;
+}
+
+// Decompressor command for a compressed input file, or nullptr for plain text
+const char* decompressorFor(const string& filename) {
+    if (hasExtension(filename, FileExt::GZIP)) return "gzip";
+    if (hasExtension(filename, FileExt::ZSTD)) return "zstd";
+    return nullptr;
+}
+
+// Strip a compression extension (e.g. "Jan25.txt.zst" -> "Jan25.txt")
+string stripCompressionExt(const string& filename) {
+    for (const string* ext : {&FileExt::GZIP, &FileExt::ZSTD})
+        if (hasExtension(filename, *ext)) return filename.substr(0, filename.size() - ext->size());
+    return filename;
+}
+
+// Use a compressed copy of an input file when the plain file is absent
+string resolveInputFile(const string& filename) {
+    struct stat st;
+    if (stat(filename.c_str(), &st) == 0) return filename;
+    for (const string* ext : {&FileExt::ZSTD, &FileExt::GZIP})
+        if (stat((filename + *ext).c_str(), &st) == 0) return filename + *ext;
+    return filename;
+}
+
+// Stream buffer reading the output of a decompressor child process, so a
+// compressed file is inflated in parallel with parsing and never hits disk
+class DecompressBuf : public streambuf {
+private:
+    int fd = -1;
+    pid_t pid = -1;
+    bool readError = false;
+    char buf[1 << 16];
+
+    // Close the pipe and reap the decompressor. A non-zero exit or a
+    // signal means the file was corrupt or truncated.
+    void finish() {
+        if (fd >= 0) close(fd);
+        fd = -1;
+        if (pid <= 0) return;
+        int status = 0;
+        pid_t reaped;
+        do {
+            reaped = waitpid(pid, &status, 0);
+        } while (reaped < 0 && errno == EINTR);
+        if (reaped != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) readError = true;
+        pid = -1;
+    }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+        if (fd < 0) return traits_type::eof();
+        ssize_t n;
+        do {
+            n = read(fd, buf, sizeof(buf));
+        } while (n < 0 && errno == EINTR);
+        if (n <= 0) {
+            if (n < 0) readError = true;
+            finish();
+            return traits_type::eof();
+        }
+        setg(buf, buf, buf + n);
+        return traits_type::to_int_type(*gptr());
+    }
+
+public:
+    ~DecompressBuf() {
+        finish();
+    }
+
+    // True once the end of the output was reached and the decompressor failed
+    bool failed() const { return readError; }
+
+    // Start "<tool> -dc -- <filename>" with its output piped to this buffer
+    bool open(const char* tool, const string& filename) {
+        int fds[2];
+        if (pipe2(fds, O_CLOEXEC) != 0) return false;
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+        string toolName = tool;
+        string flags = "-dc";
+        string endOfOptions = "--";
+        string file = filename;
+        char* argv[] = {&toolName[0], &flags[0], &endOfOptions[0], &file[0], nullptr};
+        int rc = posix_spawnp(&pid, tool, &actions, nullptr, argv, environ);
+        posix_spawn_file_actions_destroy(&actions);
+        close(fds[1]);
+        if (rc != 0) {
+            close(fds[0]);
+            pid = -1;
+            return false;
+        }
+        fd = fds[0];
+        return true;
+    }
+};
+
+// Stream buffer passing another buffer's bytes through while hashing them,
+// so a file's fingerprint comes from the same read that parses it
+class HashingBuf : public streambuf {
+private:
+    streambuf* source = nullptr;
+    StreamHasher hasher;
+    char buf[1 << 16];
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+        streamsize n = source ? source->sgetn(buf, sizeof(buf)) : 0;
+        if (n <= 0) return traits_type::eof();
+        hasher.update(buf, static_cast<size_t>(n));
+        setg(buf, buf, buf + n);
+        return traits_type::to_int_type(*gptr());
+    }
+
+public:
+    void attach(streambuf* s) { source = s; }
+    uint64_t digest() const { return hasher.digest(); }
+};
+
+// Read-only stream buffer over text already in memory, so it can be
+// parsed in place instead of being copied into a string stream
+class MemoryBuf : public streambuf {
+public:
+    MemoryBuf(const char* begin, const char* end) {
+        setg(const_cast<char*>(begin), const_cast<char*>(begin), const_cast<char*>(end));
+    }
+};
+
+// Input stream over a plain or compressed (.gz / .zst) text file. When
+// asked to, it hashes the (decompressed) text as it is read.
+class InputFile : public istream {
+private:
+    filebuf file;
+    DecompressBuf decompressed;
+    HashingBuf hashing;
+
+public:
+    explicit InputFile(const string& filename, bool hashContents = false) : istream(nullptr) {
+        struct stat st;
+        const char* tool = decompressorFor(filename);
+        if (tool) {
+            // Check first, as the decompressor would only fail once running
+            if (stat(filename.c_str(), &st) == 0 && decompressed.open(tool, filename)) rdbuf(&decompressed);
+        } else if (file.open(filename, ios::in | ios::binary)) {
+            rdbuf(&file);
+        }
+        if (!rdbuf()) {
+            setstate(ios::badbit);
+        } else if (hashContents) {
+            hashing.attach(rdbuf());
+            rdbuf(&hashing);
+        }
+    }
+
+    // Hash of the text read so far
+    uint64_t digest() const { return hashing.digest(); }
+
+    // True if the text read was cut short, e.g. by a corrupt or truncated
+    // compressed file. Check once the whole stream has been read.
+    bool readFailed() const { return bad() || decompressed.failed(); }
+};
+
+// Stream buffers over a pipe's file descriptor, used to talk to shard
+// worker processes. The descriptor stays owned by the caller.
+class FdInBuf : public streambuf {
+private:
+    int fd;
+    char buf[1 << 16];
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+        ssize_t n;
+        do {
+            n = read(fd, buf, sizeof(buf));
+        } while (n < 0 && errno == EINTR);
+        if (n <= 0) return traits_type::eof();
+        setg(buf, buf, buf + n);
+        return traits_type::to_int_type(*gptr());
+    }
+
+public:
+    explicit FdInBuf(int d) : fd(d) {}
+};
+
+class FdOutBuf : public streambuf {
+private:
+    int fd;
+    char buf[1 << 16];
+
+    // Write out the buffered bytes; false if the reader has gone away
+    bool drain() {
+        for (char* p = pbase(); p < pptr(); ) {
+            ssize_t n = write(fd, p, pptr() - p);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            p += n;
+        }
+        setp(buf, buf + sizeof(buf));
+        return true;
+    }
+
+protected:
+    int_type overflow(int_type c) override {
+        if (!drain()) return traits_type::eof();
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override { return drain() ? 0 : -1; }
+
+public:
+    explicit FdOutBuf(int d) : fd(d) { setp(buf, buf + sizeof(buf)); }
+    ~FdOutBuf() { drain(); }
+};
+
+// =============== Compressed Output ===============
+// Compressor command for a compressed output extension
+const char* compressorFor(const string& ext) {
+    if (ext == FileExt::GZIP) return "gzip";
+    if (ext == FileExt::ZSTD) return "zstd";
+    return nullptr;
+}
+
+// Compress one block by piping it through "<tool> -c". A helper thread
+// feeds the compressor's stdin while this thread drains its stdout. The
+// feeder blocks SIGPIPE, so a compressor that exits early fails the block
+// (EPIPE) instead of killing the process.
+bool compressBlock(const char* tool, const char* data, size_t size, string& out) {
+    int in[2], outPipe[2];
+    if (pipe2(in, O_CLOEXEC) != 0) return false;
+    if (pipe2(outPipe, O_CLOEXEC) != 0) {
+        close(in[0]);
+        close(in[1]);
+        return false;
+    }
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, in[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, outPipe[1], STDOUT_FILENO);
+    string toolName = tool;
+    string flags = "-cnq";  // To stdout, no name/timestamp, quiet
+    char* argv[] = {&toolName[0], &flags[0], nullptr};
+    pid_t pid;
+    int rc = posix_spawnp(&pid, tool, &actions, nullptr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(in[0]);
+    close(outPipe[1]);
+    if (rc != 0) {
+        close(in[1]);
+        close(outPipe[0]);
+        return false;
+    }
+
+    bool fed = false;
+    thread feeder([&] {
+        sigset_t pipeSignal;
+        sigemptyset(&pipeSignal);
+        sigaddset(&pipeSignal, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &pipeSignal, nullptr);
+        size_t sent = 0;
+        while (sent < size) {
+            ssize_t n = write(in[1], data + sent, size - sent);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            sent += n;
+        }
+        if (sent < size && errno == EPIPE) {
+            // Discard the SIGPIPE left pending on this thread
+            timespec noWait{0, 0};
+            sigtimedwait(&pipeSignal, nullptr, &noWait);
+        }
+        fed = sent == size;
+        close(in[1]);
+    });
+    out.clear();
+    char buf[1 << 16];
+    ssize_t n;
+    while ((n = read(outPipe[0], buf, sizeof(buf))) != 0) {
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) break;
+        out.append(buf, n);
+    }
+    close(outPipe[0]);
+    feeder.join();
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return fed && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Compress text as independent blocks on worker threads. Both gzip members
+// and zstd frames may be concatenated, so the joined blocks decompress to
+// the original text with the standard tools.
+bool compressParallel(const string& ext, const string& text, string& out) {
+    const char* tool = compressorFor(ext);
+    if (!tool) return false;
+    size_t blocks = max<size_t>(1, (text.size() + Payroll::COMPRESS_BLOCK_BYTES - 1) / Payroll::COMPRESS_BLOCK_BYTES);
+    vector<string> compressed(blocks);
+    atomic<size_t> next(0);
+    atomic<bool> failed(false);
+    vector<thread> pool;
+    size_t workers = min<size_t>(blocks, max(1u, thread::hardware_concurrency()));
+    for (size_t w = 0; w < workers; ++w) {
+        pool.emplace_back([&] {
+            for (size_t b; (b = next++) < blocks && !failed; ) {
+                size_t begin = b * Payroll::COMPRESS_BLOCK_BYTES;
+                size_t len = min(Payroll::COMPRESS_BLOCK_BYTES, text.size() - begin);
+                if (!compressBlock(tool, text.data() + begin, len, compressed[b])) failed = true;
+            }
+        });
+    }
+    for (auto& t : pool) t.join();
+    if (failed) return false;
+    out.clear();
+    for (const auto& block : compressed) out += block;
+    return true;
+}
+
+// =============== Processed File Manifest ===============
+// Identity of the contents a month was processed from. Size and
+// modification time describe the file on disk, so an unchanged file need
+// not be read; the hash and record count describe the month's contents.
+struct FileFingerprint {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    uint64_t hash = 0;
+    uint64_t records = 0;
+};
+
+// Persistent record of the last file processed for each month, so that
+// byte-identical resubmissions can be skipped, and of
+// each report written, so unchanged reports are not rewritten. Stored as
+// "pay MONTH size mtime hash records" and "report FILE size mtime hash" lines.
+// Safe to use from several threads.
+class ProcessedManifest {
+private:
+    static constexpr const char* PAY_TAG = "pay";
+    static constexpr const char* REPORT_TAG = "report";
+    string path;
+    map<string, FileFingerprint> entries;  // Month -> last processed file
+    map<string, FileFingerprint> reports;  // Output file -> last written contents
+    mutable mutex mtx;
+
+public:
+    explicit ProcessedManifest(const string& manifestPath) : path(manifestPath) {}
+
+    void load() {
+        lock_guard<mutex> lock(mtx);
+        ifstream fin(path);
+        string line;
+        while (getline(fin, line)) {
+            istringstream iss(line);
+            string tag, key;
+            FileFingerprint fp;
+            if (!(iss >> tag >> key >> fp.size >> fp.mtime >> hex >> fp.hash)) continue;
+            iss >> dec >> fp.records;
+            if (tag == PAY_TAG) entries[key] = fp;
+            else if (tag == REPORT_TAG) reports[key] = fp;
+        }
+    }
+
+    // Rewrite the manifest via a temporary file so it is never half written
+    bool save() const {
+        lock_guard<mutex> lock(mtx);
+        string tmp = path + ".tmp";
+        ofstream fout(tmp);
+        if (!fout) return false;
+        for (const auto& [month, fp] : entries)
+            fout << PAY_TAG << " " << month << " " << fp.size << " " << fp.mtime << " " << hex << fp.hash << dec
+                 << " " << fp.records << "\n";
+        for (const auto& [fname, fp] : reports)
+            fout << REPORT_TAG << " " << fname << " " << fp.size << " " << fp.mtime << " " << hex << fp.hash << dec << "\n";
+        fout.close();
+        return fout && rename(tmp.c_str(), path.c_str()) == 0;
+    }
+
+    // Fill in a file's size and modification time (in nanoseconds, so a
+    // rewrite within the same second is still noticed)
+    static bool statFile(const string& filename, FileFingerprint& fp) {
+        struct stat st;
+        if (stat(filename.c_str(), &st) != 0) return false;
+        fp.size = static_cast<uint64_t>(st.st_size);
+        fp.mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+        return true;
+    }
+
+    // Stat and hash a file's contents
+    static bool hashFile(const string& filename, FileFingerprint& fp) {
+        if (!statFile(filename, fp)) return false;
+        ifstream fin(filename, ios::binary);
+        if (!fin) return false;
+        vector<char> buf(1 << 16);
+        StreamHasher hasher;
+        while (fin.read(buf.data(), buf.size()) || fin.gcount() > 0)
+            hasher.update(buf.data(), static_cast<size_t>(fin.gcount()));
+        fp.hash = hasher.digest();
+        return true;
+    }
+
+    // True if a stat'ed file still has the size and modification time
+    // recorded for the month, in which case its recorded hash and record
+    // count are filled in and the file need not be read to fingerprint it
+    bool knownContents(const string& month, FileFingerprint& fp) const {
+        lock_guard<mutex> lock(mtx);
+        auto it = entries.find(month);
+        if (it == entries.end() || it->second.size != fp.size || it->second.mtime != fp.mtime) return false;
+        fp.hash = it->second.hash;
+        fp.records = it->second.records;
+        return true;
+    }
+
+    // True if the month has the same contents as when it was last processed
+    bool matches(const string& month, const FileFingerprint& fp) const {
+        lock_guard<mutex> lock(mtx);
+        auto it = entries.find(month);
+        return it != entries.end() && it->second.hash == fp.hash && it->second.records == fp.records;
+    }
+
+    void record(const string& month, const FileFingerprint& fp) {
+        lock_guard<mutex> lock(mtx);
+        entries[month] = fp;
+    }
+
+    // True if the report file on disk already holds exactly the given
+    // contents. The stored hash is trusted while the file's size and
+    // modification time are unchanged; otherwise the file is re-hashed
+    // and the result remembered.
+    bool reportUnchanged(const string& fname, uint64_t size, uint64_t hash) {
+        FileFingerprint onDisk;
+        if (!statFile(fname, onDisk) || onDisk.size != size) return false;
+        {
+            lock_guard<mutex> lock(mtx);
+            auto it = reports.find(fname);
+            if (it != reports.end() && it->second.size == onDisk.size && it->second.mtime == onDisk.mtime)
+                return it->second.hash == hash;
+        }
+        if (!hashFile(fname, onDisk)) return false;
+        lock_guard<mutex> lock(mtx);
+        reports[fname] = onDisk;
+        return onDisk.hash == hash;
+    }
+
+    // Remember the contents of a report that was just written
+    void recordReport(const string& fname, uint64_t hash) {
+        FileFingerprint fp;
+        if (!statFile(fname, fp)) return;
+        fp.hash = hash;
+        lock_guard<mutex> lock(mtx);
+        reports[fname] = fp;
+    }
+};
+
+// =============== Employee ID Filter ===============
+// Bloom filter over the employee master's IDs. Lets the pay file loader reject
+// most unknown IDs without touching the main employee index.
+class IdBloomFilter {
+private:
+    static const size_t BITS_PER_KEY = 10;
+    static const int NUM_HASHES = 7;
+    vector<uint64_t> bits;
+    size_t numBits = 0;
+
+public:
+    // Size the filter for the expected number of IDs and clear it
+    void reset(size_t expectedKeys) {
+        numBits = max<size_t>(64, expectedKeys * BITS_PER_KEY);
+        bits.assign((numBits + 63) / 64, 0);
+    }
+
+    void add(const string& id) {
+        size_t h1 = hash<string>{}(id);
+        size_t h2 = (h1 >> 17) | (h1 << 47) | 1;  // Double hashing
+        for (int i = 0; i < NUM_HASHES; ++i) {
+            size_t bit = (h1 + i * h2) % numBits;
+            bits[bit / 64] |= uint64_t(1) << (bit % 64);
+        }
+    }
+
+    // Number of IDs the filter was sized for
+    size_t capacity() const { return numBits / BITS_PER_KEY; }
+
+    // False means the ID is definitely not an employee
+    bool mayContain(const string& id) const {
+        if (numBits == 0) return false;
+        size_t h1 = hash<string>{}(id);
+        size_t h2 = (h1 >> 17) | (h1 << 47) | 1;
+        for (int i = 0; i < NUM_HASHES; ++i) {
+            size_t bit = (h1 + i * h2) % numBits;
+            if (!(bits[bit / 64] & (uint64_t(1) << (bit % 64)))) return false;
+        }
+        return true;
+    }
+};
+
+// =============== Employee Prefix Index ===============
+// Sorted ID and name keys for the employee picker. Every employee whose ID
+// (or, failing that, name) starts with a typed prefix is one contiguous
+// range found by binary search, so pages can be sliced out directly.
+class EmployeePrefixIndex {
+public:
+    struct Entry {
+        string key;  // Uppercased ID or name
+        string id;
+    };
+    using Range = pair<vector<Entry>::const_iterator, vector<Entry>::const_iterator>;
+
+private:
+    vector<Entry> byId;
+    vector<Entry> byName;
+
+    static Range prefixRange(const vector<Entry>& keys, const string& prefix) {
+        auto first = lower_bound(keys.begin(), keys.end(), prefix,
+                                 [](const Entry& e, const string& p) { return e.key < p; });
+        auto last = partition_point(first, keys.end(),
+                                    [&](const Entry& e) { return e.key.compare(0, prefix.size(), prefix) == 0; });
+        return {first, last};
+    }
+
+    static bool byKey(const Entry& a, const Entry& b) {
+        return a.key != b.key ? a.key < b.key : a.id < b.id;
+    }
+
+public:
+    void clear() {
+        byId.clear();
+        byName.clear();
+    }
+
+    void add(const string& id, const string& name) {
+        byId.push_back({id, id});
+        byName.push_back({toUpper(name), id});
+    }
+
+    // Sort the keys once all employees have been added
+    void build() {
+        sort(byId.begin(), byId.end(), byKey);
+        sort(byName.begin(), byName.end(), byKey);
+    }
+
+    // Add or remove one employee in an already built index
+    void insert(const string& id, const string& name) {
+        Entry idEntry{id, id}, nameEntry{toUpper(name), id};
+        byId.insert(upper_bound(byId.begin(), byId.end(), idEntry, byKey), idEntry);
+        byName.insert(upper_bound(byName.begin(), byName.end(), nameEntry, byKey), nameEntry);
+    }
+
+    void erase(const string& id, const string& name) {
+        Entry idEntry{id, id}, nameEntry{toUpper(name), id};
+        auto it = lower_bound(byId.begin(), byId.end(), idEntry, byKey);
+        if (it != byId.end() && it->id == id) byId.erase(it);
+        it = lower_bound(byName.begin(), byName.end(), nameEntry, byKey);
+        if (it != byName.end() && it->id == id) byName.erase(it);
+    }
+
+    // Employees whose ID starts with the (uppercased) prefix, or whose name
+    // does when no ID matches. An empty prefix matches everyone by ID.
+    Range find(const string& prefix) const {
+        Range ids = prefixRange(byId, prefix);
+        if (ids.first != ids.second) return ids;
+        return prefixRange(byName, prefix);
+    }
+};
+
+// =============== Employee ID Suggestions ===============
+// BK-tree over the employee master's IDs under edit distance. A lookup only
+// descends into children whose edge distance is within the search radius of
+// the query's distance to the node, so suggesting the nearest valid IDs for
+// a mistyped one touches a small part of the tree even for large masters.
+class IdSuggestionIndex {
+private:
+    // Breadth-first node layout: a node's children are contiguous and its
+    // ID lives in the shared pool, keeping lookups cache-friendly
+    struct Node {
+        uint32_t idOffset;
+        uint32_t idLength;
+        uint32_t edge;        // Distance from the parent's ID
+        uint32_t firstChild;
+        uint32_t childCount;
+    };
+    vector<Node> nodes;  // nodes[0] is the root
+    string idPool;
+    bool inAlphabet[256] = {};  // Characters used in any ID
+
+    // Edit distance from a fixed ID, bit-parallel (Myers) for IDs of up to
+    // 64 characters and a plain dynamic programme beyond that
+    class DistanceFrom {
+    private:
+        const string& pattern;
+        uint64_t peq[256] = {};  // Bit i set where pattern[i] is the character
+        uint64_t last = 0;
+
+    public:
+        explicit DistanceFrom(const string& p) : pattern(p) {
+            if (p.empty() || p.size() > 64) return;
+            for (size_t i = 0; i < p.size(); ++i)
+                peq[static_cast<unsigned char>(p[i])] |= uint64_t(1) << i;
+            last = uint64_t(1) << (p.size() - 1);
+        }
+
+        int operator()(const char* text, size_t n) const {
+            if (last == 0) {
+                vector<int> row(n + 1);
+                for (size_t j = 0; j <= n; ++j) row[j] = static_cast<int>(j);
+                for (size_t i = 1; i <= pattern.size(); ++i) {
+                    int diag = row[0];
+                    row[0] = static_cast<int>(i);
+                    for (size_t j = 1; j <= n; ++j) {
+                        int above = row[j];
+                        row[j] = min({row[j] + 1, row[j - 1] + 1, diag + (pattern[i - 1] != text[j - 1])});
+                        diag = above;
+                    }
+                }
+                return row[n];
+            }
+            uint64_t pv = ~uint64_t(0), mv = 0;
+            int score = static_cast<int>(pattern.size());
+            for (size_t k = 0; k < n; ++k) {
+                uint64_t eq = peq[static_cast<unsigned char>(text[k])];
+                uint64_t xv = eq | mv;
+                uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+                uint64_t ph = mv | ~(xh | pv);
+                uint64_t mh = pv & xh;
+                if (ph & last) ++score;
+                else if (mh & last) --score;
+                ph = (ph << 1) | 1;
+                mh <<= 1;
+                pv = mh | ~(xv | ph);
+                mv = ph & xv;
+            }
+            return score;
+        }
+    };
+
+public:
+    bool empty() const { return nodes.empty(); }
+
+    void clear() {
+        invalidate();
+        fill(begin(inAlphabet), end(inAlphabet), false);
+    }
+
+    // Drop the tree after the set of IDs changes; it is rebuilt when next needed
+    void invalidate() {
+        nodes.clear();
+        idPool.clear();
+    }
+
+    // Record the characters of a valid ID; one-edit variants only use these
+    void addAlphabet(const string& id) {
+        for (unsigned char c : id) inAlphabet[c] = true;
+    }
+
+    // Build the tree level by level: each group's first ID becomes a node and
+    // the rest of the group is split by distance to it into the node's children
+    void build(const vector<string>& ids) {
+        invalidate();
+        if (ids.empty()) return;
+        struct Group {
+            vector<uint32_t> members;  // Indexes into ids
+            uint32_t edge;
+        };
+        deque<Group> groups;
+        groups.push_back({vector<uint32_t>(ids.size()), 0});
+        for (uint32_t i = 0; i < ids.size(); ++i) groups.front().members[i] = i;
+        nodes.reserve(ids.size());
+        while (!groups.empty()) {
+            Group group = move(groups.front());
+            groups.pop_front();
+            const string& id = ids[group.members[0]];
+            uint32_t firstChild = static_cast<uint32_t>(nodes.size() + 1 + groups.size());
+            map<uint32_t, vector<uint32_t>> children;  // Distance -> IDs
+            DistanceFrom distance(id);
+            for (size_t m = 1; m < group.members.size(); ++m) {
+                const string& other = ids[group.members[m]];
+                int d = distance(other.data(), other.size());
+                if (d > 0) children[d].push_back(group.members[m]);  // Skip duplicates
+            }
+            nodes.push_back({static_cast<uint32_t>(idPool.size()), static_cast<uint32_t>(id.size()),
+                             group.edge, firstChild, static_cast<uint32_t>(children.size())});
+            idPool += id;
+            for (auto& [d, members] : children) groups.push_back({move(members), d});
+        }
+    }
+
+    // Up to `limit` valid IDs, in ID order, one edit from the query. Mistyped
+    // IDs are usually one edit out, and trying each variant against `isValid`
+    // is much cheaper than searching the tree.
+    template <typename IsValid>
+    vector<string> oneEditAway(const string& query, IsValid isValid, size_t limit) const {
+        string alphabet;
+        for (int c = 0; c < 256; ++c)
+            if (inAlphabet[c]) alphabet += static_cast<char>(c);
+        set<string> found;
+        string variant;
+        for (size_t i = 0; i <= query.size(); ++i) {
+            for (char c : alphabet) {
+                variant = query.substr(0, i) + c + query.substr(i);  // Insertion
+                if (isValid(variant)) found.insert(variant);
+                if (i == query.size() || c == query[i]) continue;
+                variant = query;                                       // Substitution
+                variant[i] = c;
+                if (isValid(variant)) found.insert(variant);
+            }
+            if (i < query.size()) {
+                variant = query.substr(0, i) + query.substr(i + 1);   // Deletion
+                if (isValid(variant)) found.insert(variant);
+            }
+        }
+        vector<string> ids(found.begin(), found.end());
+        if (ids.size() > limit) ids.resize(limit);
+        return ids;
+    }
+
+    // Up to `limit` valid IDs, in ID order, among those closest to the query
+    // and no more than `maxDistance` edits away. Their distance goes in
+    // `distanceFound` if asked.
+    vector<string> closest(const string& query, int maxDistance, size_t limit, int* distanceFound = nullptr) const {
+        if (nodes.empty()) return {};
+        DistanceFrom distance(query);
+        int radius = maxDistance;  // Shrinks to the closest distance found so far
+        vector<uint32_t> found;
+        vector<pair<uint32_t, int>> pending{{0, 0}};  // Node, lower bound on its distance
+        while (!pending.empty()) {
+            auto [index, bound] = pending.back();
+            pending.pop_back();
+            if (bound > radius) continue;
+            const Node& node = nodes[index];
+            int d = distance(idPool.data() + node.idOffset, node.idLength);
+            if (d < radius) {
+                radius = d;
+                found.clear();
+            }
+            if (d <= radius) found.push_back(index);
+            // Visit the child at the same distance first; it is the likeliest
+            // to hold a close match and shrink the radius early
+            uint32_t same = 0;
+            for (uint32_t c = node.firstChild; c < node.firstChild + node.childCount; ++c) {
+                int gap = abs(static_cast<int>(nodes[c].edge) - d);
+                if (gap == 0) same = c;
+                else if (gap <= radius) pending.push_back({c, gap});
+            }
+            if (same) pending.push_back({same, 0});
+        }
+        vector<string> ids;
+        for (uint32_t index : found)
+            ids.push_back(idPool.substr(nodes[index].idOffset, nodes[index].idLength));
+        if (distanceFound && !ids.empty()) *distanceFound = radius;
+        sort(ids.begin(), ids.end());
+        if (ids.size() > limit) ids.resize(limit);
+        return ids;
+    }
+};
+
+// =============== External Sorter ===============
+// Ranks (key, employee ID) pairs in descending key order within a memory
+// budget. Once the buffer exceeds the budget it is sorted and spilled to a
+// temporary run file; the runs are then merged with a k-way heap merge.
+// The buffer is charged for its whole capacity, not just the records in it.
+class ExternalSorter {
+public:
+    struct Record {
+        double key;
+        string id;
+    };
+
+private:
+    size_t memoryBudget;
+    size_t idBytes = 0;    // ID characters held by buffered records
+    size_t peakBytes = 0;  // Most bytes buffered at once
+    vector<Record> buffer;
+    vector<FILE*> runs;
+
+    size_t bufferedBytes() const {
+        return buffer.capacity() * sizeof(Record) + idBytes;
+    }
+
+    // Grow a full buffer geometrically, but only as far as the budget
+    // leaves room for, so its capacity is never the part that overshoots
+    void growBuffer() {
+        size_t room = memoryBudget > idBytes ? (memoryBudget - idBytes) / sizeof(Record) : 0;
+        size_t doubled = max<size_t>(buffer.capacity() * 2, 16);
+        buffer.reserve(max(buffer.size() + 1, min(doubled, room)));
+    }
+
+    // Descending key, ties broken by ascending ID so output is deterministic
+    static bool before(const Record& a, const Record& b) {
+        if (a.key != b.key) return a.key > b.key;
+        return a.id < b.id;
+    }
+
+    static bool writeRecord(FILE* f, const Record& r) {
+        uint32_t len = static_cast<uint32_t>(r.id.size());
+        return fwrite(&r.key, sizeof(r.key), 1, f) == 1 &&
+               fwrite(&len, sizeof(len), 1, f) == 1 &&
+               fwrite(r.id.data(), 1, len, f) == len;
+    }
+
+    static bool readRecord(FILE* f, Record& r) {
+        uint32_t len;
+        if (fread(&r.key, sizeof(r.key), 1, f) != 1) return false;
+        if (fread(&len, sizeof(len), 1, f) != 1) return false;
+        r.id.resize(len);
+        return fread(&r.id[0], 1, len, f) == len;
+    }
+
+    // Sort the in-memory buffer and write it out as one run. On failure the
+    // buffer is kept (sorted) and nothing is lost.
+    bool spill() {
+        sort(buffer.begin(), buffer.end(), before);
+        FILE* f = tmpfile();
+        bool ok = f != nullptr;
+        for (size_t i = 0; ok && i < buffer.size(); ++i) ok = writeRecord(f, buffer[i]);
+        if (ok) ok = fflush(f) == 0 && fseek(f, 0, SEEK_SET) == 0;
+        if (!ok) {
+            if (f) fclose(f);
+            cerr << "Warning: Could not write a sort run to a temporary file; sorting in memory" << endl;
+            return false;
+        }
+        runs.push_back(f);
+        buffer.clear();  // Capacity is kept for the next run and stays charged
+        idBytes = 0;
+        return true;
+    }
+
+public:
+    explicit ExternalSorter(size_t budget = Payroll::SORT_MEMORY_BUDGET)
+        : memoryBudget(budget) {}
+
+    ~ExternalSorter() {
+        for (FILE* f : runs) fclose(f);
+    }
+
+    ExternalSorter(const ExternalSorter&) = delete;
+    ExternalSorter& operator=(const ExternalSorter&) = delete;
+
+    void add(double key, const string& id) {
+        if (buffer.size() == buffer.capacity()) growBuffer();
+        buffer.push_back({key, id});
+        idBytes += buffer.back().id.capacity();
+        peakBytes = max(peakBytes, bufferedBytes());
+        // Keep everything in memory if spilling is impossible
+        if (bufferedBytes() >= memoryBudget && !spill()) memoryBudget = numeric_limits<size_t>::max();
+    }
+
+    size_t runCount() const { return runs.size(); }
+    size_t peakBufferedBytes() const { return peakBytes; }
+
+    // Visit every record in sorted order. Returns false if a run could not
+    // be read back, in which case some records were not visited.
+    template <typename Visitor>
+    bool forEachSorted(Visitor visit) {
+        if (runs.empty()) {
+            sort(buffer.begin(), buffer.end(), before);
+            for (const auto& r : buffer) visit(r);
+            return true;
+        }
+        // A buffer that cannot be spilled is merged from memory as one more run
+        if (!buffer.empty()) spill();
+        size_t memoryRun = runs.size();
+        size_t memoryPos = 0;
+        auto nextRecord = [&](size_t run, Record& r) {
+            if (run < memoryRun) return readRecord(runs[run], r);
+            if (memoryPos == buffer.size()) return false;
+            r = move(buffer[memoryPos++]);
+            return true;
+        };
+
+        // Heap holds the current head record of each run
+        using Head = pair<Record, size_t>;
+        auto cmp = [](const Head& a, const Head& b) { return before(b.first, a.first); };
+        priority_queue<Head, vector<Head>, decltype(cmp)> heads(cmp);
+        for (size_t i = 0; i <= memoryRun; ++i) {
+            Record r;
+            if (nextRecord(i, r)) heads.push({move(r), i});
+        }
+        while (!heads.empty()) {
+            Head top = heads.top();
+            heads.pop();
+            visit(top.first);
+            Record next;
+            if (nextRecord(top.second, next)) heads.push({move(next), top.second});
+        }
+        bool ok = true;
+        for (FILE* f : runs) ok = ok && !ferror(f);
+        if (!ok) cerr << "Error: Could not read back a sort run; the ranking is incomplete" << endl;
+        return ok;
+    }
+};
+
+// =============== Bounded Queue ===============
+// Blocking FIFO with a fixed capacity, used to hand work between pipeline
+// stages. push() waits while the queue is full, giving backpressure; pop()
+// returns false once the queue is closed and drained.
+template <typename T>
+class BoundedQueue {
+private:
+    size_t capacity;
+    std::queue<T> items;
+    bool closed = false;
+    mutex mtx;
+    condition_variable notFull;
+    condition_variable notEmpty;
+
+public:
+    explicit BoundedQueue(size_t cap) : capacity(max<size_t>(1, cap)) {}
+
+    void push(T item) {
+        unique_lock<mutex> lock(mtx);
+        notFull.wait(lock, [this] { return items.size() < capacity || closed; });
+        if (closed) return;
+        items.push(move(item));
+        notEmpty.notify_one();
+    }
+
+    bool pop(T& out) {
+        unique_lock<mutex> lock(mtx);
+        notEmpty.wait(lock, [this] { return !items.empty() || closed; });
+        if (items.empty()) return false;
+        out = move(items.front());
+        items.pop();
+        notFull.notify_one();
+        return true;
+    }
+
+    // No more items will be pushed; wakes any waiting consumers
+    void close() {
+        lock_guard<mutex> lock(mtx);
+        closed = true;
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+};
+
+// =============== Tax Engine ===============
+// Progressive income tax bands for one tax year. Each band is a rate step
+// at a taxable-income threshold. Evaluation has no branches (clamping at
+// zero is done arithmetically) and runs a band at a time over blocks of a
+// month's gross pay column, so the compiler vectorises every loop. The
+// year's National Insurance, pension and student loan rates live alongside.
+struct TaxBands {
+    static const int MAX_BANDS = 8;
+    static const size_t BLOCK = 256;                           // Employees evaluated per block
+    double allowance = Payroll::TAX_FREE_ALLOWANCE;            // Tax-free personal allowance
+    double taperStart = numeric_limits<double>::max();         // Income where the allowance is withdrawn
+    double taperRate = 0.0;                                    // Allowance lost per pound above taperStart
+    double thresholds[MAX_BANDS] = {};                         // Taxable income where each band starts
+    double rateSteps[MAX_BANDS] = {};                          // Rate increase at each threshold
+    double rates[MAX_BANDS] = {};                              // Rate charged within each band
+    double topRate = 0.0;
+    int bands = 0;
+    // Other deductions, on annual pay; none unless tax_bands.txt sets them
+    double niThreshold = 0.0;                                  // Primary threshold
+    double niRate = 0.0;                                       // Between the threshold and upper limit
+    double niUpperLimit = numeric_limits<double>::max();
+    double niUpperRate = 0.0;                                  // Above the upper limit
+    double pensionLower = 0.0;                                 // Qualifying earnings band
+    double pensionUpper = numeric_limits<double>::max();
+    double pensionRate = 0.0;
+    double studentLoanThreshold = 0.0;
+    double studentLoanRate = 0.0;
+
+    // max(x, 0) without a branch; exact, since x + |x| is 0 or 2x
+    static double positivePart(double x) {
+        return (x + fabs(x)) * 0.5;
+    }
+
+    // Append a band; thresholds must ascend
+    bool addBand(double threshold, double rate) {
+        if (bands == MAX_BANDS || (bands > 0 && threshold <= thresholds[bands - 1])) return false;
+        thresholds[bands] = threshold;
+        rateSteps[bands] = rate - topRate;
+        rates[bands] = rate;
+        topRate = rate;
+        ++bands;
+        return true;
+    }
+
+    // Rate charged within band b, or the top rate past the last band
+    double bandRate(int b) const {
+        return bands == 0 ? 0.0 : rates[min(b, bands - 1)];
+    }
+
+    // Annual tax for a column of annual incomes, with each employee's
+    // allowance, allowance taper rate and rate class from their tax code:
+    // banded is 1 for employees taxed through the bands and 0 for those
+    // taxed on all income at flatRate
+    void annualTax(const double* income, const double* allowances, const double* tapers,
+                   const double* banded, const double* flatRate, double* tax, size_t n) const {
+        const double start = taperStart;
+        double annual[BLOCK], allowed[BLOCK], taper[BLOCK], bandedBlock[BLOCK], flatBlock[BLOCK];
+        double taxable[BLOCK], out[BLOCK];
+        for (size_t base = 0; base < n; base += BLOCK) {
+            size_t m = min(BLOCK, n - base);
+            auto load = [&](const double* column, double* block) {  // Padded to a full block
+                copy(column + base, column + base + m, block);
+                fill(block + m, block + BLOCK, 0.0);
+            };
+            load(income, annual);
+            load(allowances, allowed);
+            load(tapers, taper);
+            load(banded, bandedBlock);
+            load(flatRate, flatBlock);
+            for (size_t i = 0; i < BLOCK; ++i) {
+                double kept = positivePart(allowed[i] - positivePart(annual[i] - start) * taper[i]);
+                taxable[i] = positivePart(annual[i] - kept);
+                out[i] = 0.0;
+            }
+            for (int b = 0; b < bands; ++b) {
+                const double threshold = thresholds[b], step = rateSteps[b];
+                for (size_t i = 0; i < BLOCK; ++i)
+                    out[i] += step * positivePart(taxable[i] - threshold);
+            }
+            for (size_t i = 0; i < BLOCK; ++i)
+                out[i] = bandedBlock[i] * out[i] + flatBlock[i] * annual[i];
+            copy(out, out + m, tax + base);
+        }
+    }
+};
+
+// Band tables by tax year, read from tax_bands.txt at startup. Lines are
+//   <year> allowance <amount>
+//   <year> taper <income> <allowance lost per pound>
+//   <year> band <taxable income> <rate>
+//   <year> ni <primary threshold> <rate>
+//   <year> ni_upper <upper earnings limit> <rate>
+//   <year> pension <lower> <upper> <rate>
+//   <year> student_loan <threshold> <rate>
+// where <year> is the calendar year the tax year starts in (April). A table
+// applies from its year until the next one; earlier years, and everything
+// when there is no file, use the built-in single band.
+class TaxEngine {
+private:
+    map<int, TaxBands> years;
+    TaxBands builtIn;
+    bool deductions = false;  // Some year sets NI, pension or student loan rates
+
+public:
+    TaxEngine() {
+        builtIn.addBand(0.0, Payroll::TAX_RATE);
+    }
+
+    bool load(const string& filename) {
+        ifstream fin(filename);
+        if (!fin) return false;
+        map<int, TaxBands> loaded;
+        string line;
+        while (getline(fin, line)) {
+            line = trim(line.substr(0, line.find('#')));
+            if (line.empty()) continue;
+            istringstream iss(line);
+            int year;
+            string kind;
+            double a, b, c;
+            bool ok = false;
+            if (iss >> year >> kind >> a) {
+                // Work on a copy, so a rejected line leaves no table behind
+                auto existing = loaded.find(year);
+                TaxBands table = existing != loaded.end() ? existing->second : TaxBands();
+                if (kind == "allowance") {
+                    table.allowance = a;
+                    ok = true;
+                } else if (kind == "taper" && iss >> b) {
+                    table.taperStart = a;
+                    table.taperRate = b;
+                    ok = true;
+                } else if (kind == "band" && iss >> b) {
+                    ok = table.addBand(a, b);
+                } else if (kind == "ni" && iss >> b) {
+                    table.niThreshold = a;
+                    table.niRate = b;
+                    ok = true;
+                } else if (kind == "ni_upper" && iss >> b) {
+                    table.niUpperLimit = a;
+                    table.niUpperRate = b;
+                    ok = true;
+                } else if (kind == "pension" && iss >> b >> c) {
+                    table.pensionLower = a;
+                    table.pensionUpper = b;
+                    table.pensionRate = c;
+                    ok = true;
+                } else if (kind == "student_loan" && iss >> b) {
+                    table.studentLoanThreshold = a;
+                    table.studentLoanRate = b;
+                    ok = true;
+                }
+                if (ok) loaded[year] = move(table);
+            }
+            if (!ok) cerr << "Warning: Ignoring tax band line \"" << line << "\" in " << filename << endl;
+        }
+        years = move(loaded);
+        deductions = any_of(years.begin(), years.end(), [](const pair<const int, TaxBands>& year) {
+            const TaxBands& t = year.second;
+            return t.niRate != 0.0 || t.niUpperRate != 0.0 || t.pensionRate != 0.0 || t.studentLoanRate != 0.0;
+        });
+        return true;
+    }
+
+    // True if any pay can have deductions besides income tax
+    bool hasDeductions() const { return deductions; }
+
+    // Tax year (by starting calendar year) of a period from monthPeriod()
+    static int taxYear(int period) {
+        return (period - Payroll::TAX_YEAR_START_MONTH) / Payroll::MONTHS_IN_YEAR;
+    }
+
+    // Month number within its tax year, 1 (April) to 12 (March)
+    static int taxMonth(int period) {
+        return (period - Payroll::TAX_YEAR_START_MONTH) % Payroll::MONTHS_IN_YEAR + 1;
+    }
+
+    // Bands for a period; months that are not calendar months use the latest table
+    const TaxBands& forPeriod(int period) const {
+        if (years.empty()) return builtIn;
+        if (period < 0) return years.rbegin()->second;
+        auto it = years.upper_bound(taxYear(period));
+        return it == years.begin() ? builtIn : prev(it)->second;
+    }
+};
+
+// An employee's PAYE tax code from employees.txt, e.g. 1257L, K475, BR or
+// 0T, optionally followed by a W1, M1 or X non-cumulative marker. Codes are
+// parsed once when the master is read, into the allowance and rate class
+// that the month kernel reads directly.
+struct TaxCode {
+    enum RateClass { BANDED, BASIC_RATE, HIGHER_RATE, ADDITIONAL_RATE, NO_TAX };
+    bool fromTable = true;       // No code: the tax year's allowance and taper apply
+    double allowance = 0.0;      // Annual tax-free pay
+    double addition = 0.0;       // Annual pay added by a K code
+    RateClass rateClass = BANDED;
+    bool nonCumulative = false;  // Each month taxed on its own under cumulative PAYE
+
+    static bool isNonCumulativeMarker(const string& token) {
+        return token == "W1" || token == "M1" || token == "X";
+    }
+
+    // Parse a code such as "1257L"; a leading S or C (Scottish or Welsh
+    // rates) is accepted and taxed on the same bands. Leaves the code
+    // unchanged if the text is not a valid code.
+    bool parse(string text) {
+        text = toUpper(text);
+        if (text.size() > 1 && (text[0] == 'S' || text[0] == 'C')) text.erase(0, 1);
+        RateClass flat = BANDED;
+        if (text == "BR") flat = BASIC_RATE;
+        else if (text == "D0") flat = HIGHER_RATE;
+        else if (text == "D1") flat = ADDITIONAL_RATE;
+        else if (text == "NT") flat = NO_TAX;
+        if (flat != BANDED) {
+            fromTable = false;
+            allowance = addition = 0.0;
+            rateClass = flat;
+            return true;
+        }
+
+        // K<number>, or <number> followed by L, M, N or T
+        bool kCode = !text.empty() && text[0] == 'K';
+        string digits = kCode ? text.substr(1) : text;
+        if (!kCode) {
+            if (digits.empty() || string("LMNT").find(digits.back()) == string::npos) return false;
+            digits.pop_back();
+        }
+        if (digits.empty() || digits.size() > 6 || !all_of(digits.begin(), digits.end(), [](char c) { return isdigit(static_cast<unsigned char>(c)); }))
+            return false;
+        int number = stoi(digits);
+        double amount = number == 0 ? 0.0 : number * Payroll::TAX_CODE_UNIT + Payroll::TAX_CODE_ROUNDING;
+        fromTable = false;
+        allowance = kCode ? 0.0 : amount;
+        addition = kCode ? amount : 0.0;
+        rateClass = BANDED;
+        return true;
+    }
+
+    // Single rate for flat-rate codes under a band table; 0 for banded
+    // codes. D0 and D1 use the statutory rates, and set `statutory`, when
+    // the table has no band for them.
+    double flatRate(const TaxBands& table, bool& statutory) const {
+        switch (rateClass) {
+            case BASIC_RATE: return table.bandRate(0);
+            case HIGHER_RATE:
+                if (table.bands > 1) return table.bandRate(1);
+                statutory = true;
+                return Payroll::HIGHER_TAX_RATE;
+            case ADDITIONAL_RATE:
+                if (table.bands > 2) return table.bandRate(2);
+                statutory = true;
+                return Payroll::ADDITIONAL_TAX_RATE;
+            default: return 0.0;
+        }
+    }
+
+    bool operator==(const TaxCode& other) const {
+        return fromTable == other.fromTable && allowance == other.allowance && addition == other.addition &&
+               rateClass == other.rateClass && nonCumulative == other.nonCumulative;
+    }
+};
+
+// =============== Deductions ===============
+// A month's pay as columns, one entry per employee, read and filled by the
+// deduction pipeline
+struct PayColumns {
+    size_t n = 0;
+    const double* gross = nullptr;
+    const double* tax = nullptr;           // From the banded tax kernel
+    const double* studentLoanPlan = nullptr;  // 1 for employees repaying a student loan, else 0
+    double* ni = nullptr;
+    double* pension = nullptr;
+    double* studentLoan = nullptr;
+    double* net = nullptr;
+};
+
+// One block of PayColumns, worked on in place by the deduction policies
+struct PayBlock {
+    static const size_t SIZE = TaxBands::BLOCK;
+    double gross[SIZE];
+    double tax[SIZE];
+    double studentLoanPlan[SIZE];
+    double ni[SIZE];
+    double pension[SIZE];
+    double studentLoan[SIZE];
+    double net[SIZE];
+};
+
+// Deduction policies. Each is built once per month from that tax year's
+// rates, and deduct() returns one employee's monthly amount, recording it
+// in its own column. Like the tax kernel they clamp arithmetically rather
+// than branch.
+class IncomeTaxDeduction {
+public:
+    explicit IncomeTaxDeduction(const TaxBands&) {}
+    double deduct(PayBlock& pay, size_t i) const {
+        return pay.tax[i];
+    }
+};
+
+class NationalInsuranceDeduction {
+private:
+    double threshold, rate, upperLimit, upperRate;
+
+public:
+    explicit NationalInsuranceDeduction(const TaxBands& rates)
+        : threshold(rates.niThreshold / Payroll::MONTHS_IN_YEAR), rate(rates.niRate),
+          upperLimit(rates.niUpperLimit / Payroll::MONTHS_IN_YEAR), upperRate(rates.niUpperRate) {}
+    double deduct(PayBlock& pay, size_t i) const {
+        double gross = pay.gross[i];
+        double aboveLimit = TaxBands::positivePart(gross - upperLimit);
+        double amount = TaxBands::positivePart(gross - aboveLimit - threshold) * rate + aboveLimit * upperRate;
+        pay.ni[i] = amount;
+        return amount;
+    }
+};
+
+class PensionDeduction {
+private:
+    double lower, upper, rate;
+
+public:
+    explicit PensionDeduction(const TaxBands& rates)
+        : lower(rates.pensionLower / Payroll::MONTHS_IN_YEAR),
+          upper(rates.pensionUpper / Payroll::MONTHS_IN_YEAR), rate(rates.pensionRate) {}
+    double deduct(PayBlock& pay, size_t i) const {
+        double gross = pay.gross[i];
+        double qualifying = TaxBands::positivePart(gross - TaxBands::positivePart(gross - upper) - lower);
+        double amount = qualifying * rate;
+        pay.pension[i] = amount;
+        return amount;
+    }
+};
+
+class StudentLoanDeduction {
+private:
+    double threshold, rate;
+
+public:
+    explicit StudentLoanDeduction(const TaxBands& rates)
+        : threshold(rates.studentLoanThreshold / Payroll::MONTHS_IN_YEAR), rate(rates.studentLoanRate) {}
+    double deduct(PayBlock& pay, size_t i) const {
+        double amount = pay.studentLoanPlan[i] * TaxBands::positivePart(pay.gross[i] - threshold) * rate;
+        pay.studentLoan[i] = amount;
+        return amount;
+    }
+};
+
+// Deductions composed at compile time and fused into one pass over the
+// month's columns: every policy is inlined into the same loop, so adding
+// one adds neither a pass over memory nor an indirect call per employee.
+// Columns are staged through a cache-resident block, as in the tax kernel,
+// which also lets the compiler see that they do not overlap.
+template <typename... Deductions>
+class DeductionPipeline {
+private:
+    tuple<Deductions...> stages;
+
+public:
+    explicit DeductionPipeline(const TaxBands& rates) : stages(Deductions(rates)...) {}
+
+    void run(const PayColumns& columns) const {
+        const tuple<Deductions...> local = stages;  // Not aliased by the block's stores
+        PayBlock pay;
+        for (size_t base = 0; base < columns.n; base += PayBlock::SIZE) {
+            size_t m = min(PayBlock::SIZE, columns.n - base);
+            auto load = [&](const double* column, double* block) {  // Padded to a full block
+                copy(column + base, column + base + m, block);
+                fill(block + m, block + PayBlock::SIZE, 0.0);
+            };
+            load(columns.gross, pay.gross);
+            load(columns.tax, pay.tax);
+            load(columns.studentLoanPlan, pay.studentLoanPlan);
+            for (size_t i = 0; i < PayBlock::SIZE; ++i) {
+                double net = pay.gross[i];
+                apply([&](const Deductions&... stage) { ((net -= stage.deduct(pay, i)), ...); }, local);
+                pay.net[i] = net;
+            }
+            copy(pay.ni, pay.ni + m, columns.ni + base);
+            copy(pay.pension, pay.pension + m, columns.pension + base);
+            copy(pay.studentLoan, pay.studentLoan + m, columns.studentLoan + base);
+            copy(pay.net, pay.net + m, columns.net + base);
+        }
+    }
+};
+
+using PayrollDeductions = DeductionPipeline<IncomeTaxDeduction, NationalInsuranceDeduction,
+                                            PensionDeduction, StudentLoanDeduction>;
+
+// =============== Overtime Rules ===============
+// Overtime tiers for one class of employee: past each monthly hours
+// threshold, hours are paid at a higher multiple of the hourly rate
+struct OvertimeTiers {
+    static const int MAX_TIERS = 4;
+    double thresholds[MAX_TIERS] = {};  // Monthly hours where each tier starts
+    double steps[MAX_TIERS] = {};       // Multiplier increase at each threshold
+    double topMultiplier = 1.0;
+    int tiers = 0;
+
+    // Append a tier; thresholds must ascend
+    bool addTier(double threshold, double multiplier) {
+        if (tiers == MAX_TIERS || (tiers > 0 && threshold <= thresholds[tiers - 1])) return false;
+        thresholds[tiers] = threshold;
+        steps[tiers] = multiplier - topMultiplier;
+        topMultiplier = multiplier;
+        ++tiers;
+        return true;
+    }
+};
+
+// Overtime tiers by employee class, read from overtime_rules.txt at startup.
+// Lines are
+//   <class> <monthly hours threshold> <multiplier>
+// e.g. "warehouse 160 1.5". Employees join a class with a "class=<name>"
+// token in employees.txt; the "default" class covers everyone else.
+// Without the file, hours are paid at the plain rate.
+class OvertimeRules {
+private:
+    vector<OvertimeTiers> classes;      // Index 0 is the default class
+    unordered_map<string, int> classIndex;
+    int mostTiers = 0;
+
+public:
+    static const int DEFAULT_CLASS = 0;
+
+    OvertimeRules() : classes(1) {
+        classIndex["default"] = DEFAULT_CLASS;
+    }
+
+    bool load(const string& filename) {
+        ifstream fin(filename);
+        if (!fin) return false;
+        string line;
+        while (getline(fin, line)) {
+            line = trim(line.substr(0, line.find('#')));
+            if (line.empty()) continue;
+            istringstream iss(line);
+            string name;
+            double threshold, multiplier;
+            bool ok = false;
+            if (iss >> name >> threshold >> multiplier) {
+                auto [it, added] = classIndex.emplace(toLower(name), static_cast<int>(classes.size()));
+                if (added) classes.emplace_back();
+                ok = classes[it->second].addTier(threshold, multiplier);
+                mostTiers = max(mostTiers, classes[it->second].tiers);
+            }
+            if (!ok) cerr << "Warning: Ignoring overtime rule \"" << line << "\" in " << filename << endl;
+        }
+        return true;
+    }
+
+    // Index of a named class, or -1 if no rules name it
+    int find(const string& name) const {
+        auto it = classIndex.find(toLower(name));
+        return it == classIndex.end() ? -1 : it->second;
+    }
+
+    const OvertimeTiers& tiersFor(int payClass) const {
+        return classes[payClass];
+    }
+
+    // Add one tier's premium hours to a column of paid hours. The columns are
+    // distinct arrays, and saying so lets the loop vectorise without
+    // run-time overlap checks.
+    static void addTierPremium(const double* __restrict hours, const double* __restrict start,
+                               const double* __restrict step, double* __restrict paid, size_t n) {
+        for (size_t i = 0; i < n; ++i)
+            paid[i] += step[i] * TaxBands::positivePart(hours[i] - start[i]);
+    }
+
+    // Most tiers any class has; 0 when there are no rules
+    int maxTiers() const {
+        return mostTiers;
+    }
+};
+
+// One employee's pay for a month, as computed by the month kernel
+struct MonthPay {
+    double rate = 0.0;
+    double hours = 0.0;
+    double gross = 0.0;
+    double tax = 0.0;
+    double net = 0.0;
+    int period = -1;        // monthPeriod() of the month
+    double ytdGross = 0.0;  // Tax year to date, including this month
+    double ytdTax = 0.0;
+    double ni = 0.0;
+    double pension = 0.0;
+    double studentLoan = 0.0;
+    double paidHours = 0.0;  // Hours with overtime premiums added, as gross is paid on
+};
+
 // =============== Employee Class ===============
 class Employee {
 public:
     string id;
     string name;
-    double hourlyRate;
+    double hourlyRate;                     // Opening rate, before any dated change
+    vector<pair<int, double>> rateHistory; // (first period, rate) changes, sorted by period
+    TaxCode taxCode;
+    bool studentLoan = false;              // Repaying a student loan through payroll
+    int payClass = OvertimeRules::DEFAULT_CLASS;  // Overtime class, an OvertimeRules index
     map<string, double> hoursWorked;  // Maps month to hours worked
+    map<string, MonthPay> payslips;   // Maps month to computed pay, kept in step with hoursWorked
 
     Employee() : hourlyRate(0.0) {}
     Employee(const string& _id, const string& _name, double _rate)
         : id(_id), name(_name), hourlyRate(_rate) {}
 
+    // Record a rate taking effect from a period, replacing any change already
+    // recorded for that period
+    void addRateChange(int period, double rate) {
+        auto it = lower_bound(rateHistory.begin(), rateHistory.end(), make_pair(period, -numeric_limits<double>::infinity()));
+        if (it != rateHistory.end() && it->first == period) it->second = rate;
+        else rateHistory.insert(it, {period, rate});
+    }
+
+    // Rate in force now, after every dated change
+    double currentRate() const {
+        return rateHistory.empty() ? hourlyRate : rateHistory.back().second;
+    }
+
+    // Rate in force for a period from monthPeriod(); months that are not
+    // calendar months use the current rate
+    double rateAt(int period) const {
+        if (rateHistory.empty()) return hourlyRate;
+        if (period < 0) return rateHistory.back().second;
+        auto it = upper_bound(rateHistory.begin(), rateHistory.end(), make_pair(period, numeric_limits<double>::infinity()));
+        return it == rateHistory.begin() ? hourlyRate : prev(it)->second;
+    }
+
+    // Latest payslip earlier in the same tax year as a period, if any
+    const MonthPay* priorPayslip(int period) const {
+        const MonthPay* prior = nullptr;
+        for (const auto& rec : payslips) {
+            const MonthPay& pay = rec.second;
+            if (pay.period < 0 || pay.period >= period || TaxEngine::taxYear(pay.period) != TaxEngine::taxYear(period)) continue;
+            if (!prior || pay.period > prior->period) prior = &pay;
+        }
+        return prior;
+    }
+
+    // Rate in force for a month; employees without rate changes skip the lookup
+    double rateFor(const string& month) const {
+        return rateHistory.empty() ? hourlyRate : rateAt(monthPeriod(month));
+    }
+
     // Calculate gross pay for a specific month
     double getGrossPay(const string& month) const {
-        auto it = hoursWorked.find(month);
-        if (it == hoursWorked.end()) return 0.0;
-        return hourlyRate * it->second;
+        auto it = payslips.find(month);
+        return it == payslips.end() ? 0.0 : it->second.gross;
     }
 
-    // Calculate monthly tax based on annual projection
+    // Monthly tax as computed by the month kernel
     double getTax(const string& month) const {
-        double gross = getGrossPay(month);
-        double annual = gross * Payroll::MONTHS_IN_YEAR;  // Project annual salary
-        double taxable = annual - Payroll::TAX_FREE_ALLOWANCE;
-        if (taxable < 0) taxable = 0;
-        double annualTax = taxable * Payroll::TAX_RATE;
-        return annualTax / Payroll::MONTHS_IN_YEAR;  // Return monthly portion
+        auto it = payslips.find(month);
+        return it == payslips.end() ? 0.0 : it->second.tax;
     }
 
     // Calculate net pay after tax deduction
     double getNetPay(const string& month) const {
-        return getGrossPay(month) - getTax(month);
+        auto it = payslips.find(month);
+        return it == payslips.end() ? 0.0 : it->second.net;
     }
 
     // Calculate total gross pay across all months
     double getTotalGross() const {
         double total = 0.0;
-        for (const auto& rec : hoursWorked)
-            total += getGrossPay(rec.first);
+        for (const auto& rec : payslips)
+            total += rec.second.gross;
         return total;
     }
 
     // Calculate total tax across all months
     double getTotalTax() const {
         double total = 0.0;
-        for (const auto& rec : hoursWorked)
-            total += getTax(rec.first);
+        for (const auto& rec : payslips)
+            total += rec.second.tax;
         return total;
     }
 
     // Calculate total net pay across all months
     double getTotalNet() const {
         double total = 0.0;
-        for (const auto& rec : hoursWorked)
-            total += getNetPay(rec.first);
+        for (const auto& rec : payslips)
+            total += rec.second.net;
         return total;
     }
+
+    // Total National Insurance, pension and student loan deductions across all months
+    void getTotalDeductions(double& ni, double& pension, double& studentLoan) const {
+        ni = pension = studentLoan = 0.0;
+        for (const auto& rec : payslips) {
+            ni += rec.second.ni;
+            pension += rec.second.pension;
+            studentLoan += rec.second.studentLoan;
+        }
+    }
+};
+
+// One parsed line of a pay file
+struct PayRecord {
+    string id;
+    double hours;
+};
+
+// What was read from one pay file: a single month's records, or for a
+// long-format file each month's records in order of first appearance
+struct PayFileContents {
+    bool longFormat = false;
+    string month;                            // Month file: its month
+    vector<PayRecord> records;               // Month file: its records
+    vector<string> monthOrder;               // Long format: months found
+    map<string, vector<PayRecord>> months;   // Long format: month -> records
+    map<string, size_t> invalidMonths;       // Long format: bad month -> lines skipped
+};
+
+// =============== Binary Pay Files ===============
+// Fixed-record pay file layout, read by mmap with no tokenizing. All
+// integers and doubles are little-endian.
+//   Header (24 bytes): magic "PAYBIN1\0" | month code, char[8], NUL-padded
+//                      | uint64 record count
+//   Record (24 bytes): employee ID, char[16], upper case, NUL-padded
+//                      | double hours worked
+class BinaryPayFile {
+private:
+    static constexpr char MAGIC[8] = {'P', 'A', 'Y', 'B', 'I', 'N', '1', '\0'};
+    static const size_t MONTH_BYTES = 8;
+    static const size_t ID_BYTES = 16;
+
+    struct Header {
+        char magic[8];
+        char month[MONTH_BYTES];
+        uint64_t count;
+    };
+    struct Record {
+        char id[ID_BYTES];
+        double hours;
+    };
+    static_assert(sizeof(Header) == 24 && sizeof(Record) == 24, "binary pay file layout");
+
+    // The month names the report file, so it must be letters and digits;
+    // it is upper-cased like a month taken from a text file's name
+    static bool decodeMonth(const Header& header, string& month) {
+        string code(header.month, strnlen(header.month, MONTH_BYTES));
+        if (code.empty() || !all_of(code.begin(), code.end(), [](char c) { return isalnum(static_cast<unsigned char>(c)); }))
+            return false;
+        month = toUpper(code);
+        return true;
+    }
+
+public:
+    // True if the buffer starts with the binary pay file magic
+    static bool isBinary(const char* data, size_t size) {
+        return size >= sizeof(MAGIC) && memcmp(data, MAGIC, sizeof(MAGIC)) == 0;
+    }
+
+    // True if the file on disk is a binary pay file
+    static bool isBinaryFile(const string& filename) {
+        char magic[sizeof(MAGIC)];
+        ifstream fin(filename, ios::binary);
+        return fin.read(magic, sizeof(magic)) && isBinary(magic, sizeof(magic));
+    }
+
+    // Read just the month from a binary pay file's header
+    static bool readMonth(const string& filename, string& month) {
+        Header header;
+        ifstream fin(filename, ios::binary);
+        return fin.read(reinterpret_cast<char*>(&header), sizeof(header)) && isBinary(header.magic, sizeof(header.magic))
+            && decodeMonth(header, month);
+    }
+
+    // Decode an in-memory binary pay file, passing each record's ID and
+    // hours to `visit`. False, before any record is visited, if the file is
+    // truncated or its month is invalid.
+    template <typename Visit>
+    static bool forEachRecord(const char* data, size_t size, string& month, Visit visit) {
+        if (size < sizeof(Header) || !isBinary(data, size)) return false;
+        Header header;
+        memcpy(&header, data, sizeof(header));
+        if (header.count > (size - sizeof(Header)) / sizeof(Record)) return false;
+        if (!decodeMonth(header, month)) return false;
+        const char* p = data + sizeof(Header);
+        for (uint64_t i = 0; i < header.count; ++i, p += sizeof(Record)) {
+            Record rec;
+            memcpy(&rec, p, sizeof(rec));
+            visit(string(rec.id, strnlen(rec.id, ID_BYTES)), rec.hours);
+        }
+        return true;
+    }
+
+    // Decode an in-memory binary pay file; false if it is truncated or its
+    // month is invalid
+    static bool decode(const char* data, size_t size, string& month, vector<PayRecord>& records) {
+        records.clear();
+        records.reserve(size / sizeof(Record));
+        return forEachRecord(data, size, month, [&](string&& id, double hours) { records.push_back({move(id), hours}); });
+    }
+
+    // Map a binary pay file into memory and pass each record to `visit`,
+    // hashing the file's bytes on the way if asked
+    template <typename Visit>
+    static bool scan(const string& filename, string& month, Visit visit, uint64_t* hash = nullptr) {
+        int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            close(fd);
+            return false;
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+        void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED) return false;
+        madvise(map, size, MADV_SEQUENTIAL);
+        if (hash) *hash = hashBytes(static_cast<const char*>(map), size);
+        bool ok = forEachRecord(static_cast<const char*>(map), size, month, visit);
+        munmap(map, size);
+        return ok;
+    }
+
+    // Map a binary pay file into memory and decode it, hashing its bytes
+    // on the way if asked
+    static bool read(const string& filename, string& month, vector<PayRecord>& records, uint64_t* hash = nullptr) {
+        records.clear();
+        return scan(filename, month, [&](string&& id, double hours) { records.push_back({move(id), hours}); }, hash);
+    }
+
+    // Write records in the binary layout; false if an ID or month is too long
+    static bool write(const string& filename, const string& month, const vector<PayRecord>& records) {
+        if (month.size() > MONTH_BYTES) return false;
+        Header header{};
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        memcpy(header.month, month.data(), month.size());
+        header.count = records.size();
+        string out(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.reserve(sizeof(header) + records.size() * sizeof(Record));
+        for (const auto& r : records) {
+            if (r.id.size() > ID_BYTES) return false;
+            Record rec{};
+            memcpy(rec.id, r.id.data(), r.id.size());
+            rec.hours = r.hours;
+            out.append(reinterpret_cast<const char*>(&rec), sizeof(rec));
+        }
+        ofstream fout(filename, ios::binary);
+        fout << out;
+        fout.close();
+        return static_cast<bool>(fout);
+    }
+};
+
+// Outcome of saving a month report
+enum class ReportWrite { WRITTEN, UNCHANGED, FAILED };
+
+// A pay file being read and parsed on a worker thread. The worker only
+// touches this object; the parsed records are applied on the main thread
+// once it finishes, so a cancelled load leaves nothing to roll back.
+struct BackgroundLoad {
+    string filename;
+    string month;
+    bool found = false;
+    bool complete = false;          // Read to the end without error
+    bool valid = true;              // False for a truncated or invalid binary pay file
+    FileFingerprint fingerprint;
+    uint64_t totalBytes = 0;        // 0 when unknown, as for compressed files
+    chrono::steady_clock::time_point started;
+    atomic<uint64_t> bytesRead{0};
+    atomic<uint64_t> linesRead{0};
+    atomic<bool> cancelled{false};
+    atomic<bool> done{false};
+    PayFileContents contents;
+    thread worker;
 };
 
 // =============== PayrollSystem Class ===============
@@ -147,8 +1958,25 @@ class PayrollSystem {
 private:
     map<string, Employee> employees;     // Employee database
     set<string> loadedPayFiles;          // Track processed files to avoid duplicates
+    set<string> restatedMonths;          // Written months since changed by cumulative PAYE
     vector<string> processedMonths;      // Keep order of processed months
     vector<pair<string, string>> errors; // Store errors for logging
+    map<string, vector<PayRecord>> unmatchedRecords;  // Month -> records with unknown IDs, for starters added later
+    unique_ptr<BackgroundLoad> activeLoad;   // Pay file loading in the background, if any
+    vector<pair<string, Employee*>> employeesById;  // ID-ordered and contiguous, for merge joins
+    IdBloomFilter idFilter;              // Fast reject of unknown pay file IDs
+    EmployeePrefixIndex pickerIndex;     // ID and name prefixes for the employee picker
+    IdSuggestionIndex idSuggestions;     // Nearest valid IDs, built when first needed
+    ProcessedManifest manifest{FileNames::MANIFEST_FILE};  // Contents of processed pay files
+    TaxEngine taxEngine;                 // Income tax bands by tax year
+    OvertimeRules overtimeRules;         // Overtime tiers by employee class
+    string outputCompression;            // Extension of compressed reports, empty for plain text
+    size_t sortBudget = Payroll::SORT_MEMORY_BUDGET;  // Bytes a ranking may buffer before spilling
+    bool aggregateShifts = false;        // Sum shift-level lines per employee and month
+    bool cumulativePaye = false;         // Tax on year-to-date pay rather than each month alone
+    bool warnedStatutoryRates = false;   // Warned that D0/D1 codes fell back to statutory rates
+    size_t shardIndex = 0;               // This process's shard when running as a shard worker
+    size_t shardCount = 0;               // Number of shards, or 0 when not sharded
 
     // Display formatting constants
     static const int HEADER_TOTAL_WIDTH = 70;
@@ -169,17 +1997,27 @@ private:
         const int w_name  = 18;
         const int w_rate  = 11;
         const int w_hours = 8;
+        const int w_paid  = 10;
         const int w_gross = 13;
         const int w_tax   = 12;
+        const int w_ni    = 11;
+        const int w_pension = 13;
+        const int w_loan  = 11;
         const int w_net   = 13;
 
         out << left << setw(w_id) << "ID"
             << left << setw(w_name) << "Name"
             << right << setw(w_rate) << "Rate(£)"
-            << right << setw(w_hours) << "Hours"
-            << right << setw(w_gross) << "Gross(£)"
-            << right << setw(w_tax) << "Tax(£)"
-            << right << setw(w_net) << "Net(£)"
+            << right << setw(w_hours) << "Hours";
+        if (overtimeRules.maxTiers() > 0) out << right << setw(w_paid) << "Paid Hrs";
+        out << right << setw(w_gross) << "Gross(£)"
+            << right << setw(w_tax) << "Tax(£)";
+        if (taxEngine.hasDeductions()) {
+            out << right << setw(w_ni) << "NI(£)"
+                << right << setw(w_pension) << "Pension(£)"
+                << right << setw(w_loan) << "Loan(£)";
+        }
+        out << right << setw(w_net) << "Net(£)"
             << endl;
     }
 
@@ -227,11 +2065,22 @@ private:
     }
 
 public:
-    PayrollSystem() = default;
+    PayrollSystem() {
+        manifest.load();
+        taxEngine.load(FileNames::TAX_BANDS_FILE);
+        overtimeRules.load(FileNames::OVERTIME_RULES_FILE);
+    }
 
-    // Load employee master data from file
-    bool loadEmployees(const string& filename) {
-        ifstream fin(filename);
+    ~PayrollSystem() {
+        if (activeLoad) {
+            activeLoad->cancelled = true;
+            activeLoad->worker.join();
+        }
+    }
+
+    // Parse the employee master into `out`, keeping only this shard's IDs
+    bool readEmployeeMaster(const string& filename, map<string, Employee>& out) const {
+        InputFile fin(resolveInputFile(filename));
         if (!fin) {
             cerr << "Error: Could not open " << filename << endl;
             return false;
@@ -244,104 +2093,1137 @@ public:
             if (!(iss >> id >> name >> rate)) continue;  // Skip malformed lines
             id = toUpper(trim(id));
             name = trim(name);
-            employees[id] = Employee(id, name, rate);
+            if (shardCount > 0 && shardOf(id, shardCount) != shardIndex) continue;  // Another shard's
+            Employee emp(id, name, rate);
+            string change;
+            // Optional "MONYY:rate" changes, e.g. "APR25:21.50", and tax code
+            while (iss >> change) {
+                size_t colon = change.find(':');
+                if (colon == string::npos) {
+                    if (toLower(change).rfind("class=", 0) == 0) {
+                        int payClass = overtimeRules.find(change.substr(6));
+                        if (payClass >= 0) emp.payClass = payClass;
+                        else cerr << "Warning: No overtime rules for class \"" << change.substr(6) << "\" of employee " << id << endl;
+                    } else if (toUpper(change) == "SL") emp.studentLoan = true;
+                    else if (TaxCode::isNonCumulativeMarker(toUpper(change))) emp.taxCode.nonCumulative = true;
+                    else if (!emp.taxCode.parse(change))
+                        cerr << "Warning: Ignoring tax code \"" << change << "\" for employee " << id << endl;
+                    continue;
+                }
+                int period = monthPeriod(toUpper(change.substr(0, colon)));
+                char* end = nullptr;
+                double newRate = strtod(change.c_str() + colon + 1, &end);
+                if (period < 0 || end == change.c_str() + colon + 1 || *end) continue;  // Skip malformed changes
+                emp.addRateChange(period, newRate);
+            }
+            out[id] = move(emp);
+        }
+        if (fin.readFailed()) {
+            cerr << "Error: Could not read all of " << filename << endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Load employee master data from file
+    bool loadEmployees(const string& filename) {
+        if (!readEmployeeMaster(filename, employees)) return false;
+        rebuildEmployeeIndexes();
+        return true;
+    }
+
+    // Re-read the employee master and apply only what changed. Starters are
+    // added and pick up any hours already seen for their ID, leavers are
+    // removed (their hours kept in case they return), and rate or name
+    // changes are made in place. Indexes are patched rather than rebuilt,
+    // pay is recomputed only for the employees involved, and only the
+    // reports of months involving a changed employee are rewritten.
+    bool reloadEmployees(const string& filename) {
+        map<string, Employee> fresh;
+        if (!readEmployeeMaster(filename, fresh)) return false;
+
+        // Walk both ID-ordered maps together
+        set<string> affectedMonths;
+        map<string, vector<Employee*>> repay;  // Month -> employees whose pay is recomputed
+        size_t added = 0, removed = 0, changed = 0;
+        // Unmatched records are indexed by ID only once a starter appears
+        unordered_map<string, map<string, double>> unmatchedById;  // ID -> month -> hours
+        bool unmatchedIndexed = false;
+        set<string> claimed;  // Starters that picked up unmatched hours
+        auto cur = employees.begin();
+        auto incoming = fresh.begin();
+        while (cur != employees.end() || incoming != fresh.end()) {
+            if (incoming == fresh.end() || (cur != employees.end() && cur->first < incoming->first)) {
+                Employee& leaver = cur->second;
+                for (const auto& [month, hours] : leaver.hoursWorked) {
+                    unmatchedRecords[month].push_back({leaver.id, hours});
+                    affectedMonths.insert(month);
+                }
+                pickerIndex.erase(leaver.id, leaver.name);
+                cur = employees.erase(cur);
+                ++removed;
+            } else if (cur == employees.end() || incoming->first < cur->first) {
+                Employee& starter = employees.emplace_hint(cur, incoming->first, move(incoming->second))->second;
+                if (!unmatchedIndexed) {
+                    // A repeated ID keeps its last hours, as a loaded employee's would
+                    for (const auto& [month, records] : unmatchedRecords)
+                        for (const auto& rec : records) unmatchedById[rec.id][month] = rec.hours;
+                    unmatchedIndexed = true;
+                }
+                auto hours = unmatchedById.find(starter.id);
+                if (hours != unmatchedById.end()) {
+                    for (const auto& [month, h] : hours->second) {
+                        if (!loadedPayFiles.count(month)) continue;
+                        starter.hoursWorked[month] = h;
+                        repay[month].push_back(&starter);
+                    }
+                    claimed.insert(starter.id);
+                }
+                idFilter.add(starter.id);
+                pickerIndex.insert(starter.id, starter.name);
+                idSuggestions.addAlphabet(starter.id);
+                ++incoming;
+                ++added;
+            } else {
+                Employee& e = cur->second;
+                const Employee& updated = incoming->second;
+                if (e.name != updated.name || e.hourlyRate != updated.hourlyRate || e.rateHistory != updated.rateHistory ||
+                    !(e.taxCode == updated.taxCode) || e.studentLoan != updated.studentLoan || e.payClass != updated.payClass) {
+                    if (e.name != updated.name) {
+                        pickerIndex.erase(e.id, e.name);
+                        pickerIndex.insert(e.id, updated.name);
+                    }
+                    e.name = updated.name;
+                    e.hourlyRate = updated.hourlyRate;
+                    e.rateHistory = updated.rateHistory;
+                    e.taxCode = updated.taxCode;
+                    e.studentLoan = updated.studentLoan;
+                    e.payClass = updated.payClass;
+                    for (const auto& rec : e.hoursWorked) repay[rec.first].push_back(&e);
+                    ++changed;
+                }
+                ++cur;
+                ++incoming;
+            }
+        }
+        if (added || removed) {
+            idSuggestions.invalidate();
+            rebuildIdOrder();
+        }
+        if (!claimed.empty()) {
+            for (auto it = unmatchedRecords.begin(); it != unmatchedRecords.end(); ) {
+                auto& records = it->second;
+                records.erase(remove_if(records.begin(), records.end(),
+                                        [&](const PayRecord& rec) { return claimed.count(rec.id) > 0; }),
+                              records.end());
+                it = records.empty() ? unmatchedRecords.erase(it) : next(it);
+            }
+        }
+        if (employees.size() > idFilter.capacity()) rebuildEmployeeIndexes();  // Filter outgrown
+        for (const auto& [month, rows] : repay) {
+            computePay(month, rows);
+            affectedMonths.insert(month);
+        }
+
+        cout << "Reloaded " << filename << ": " << added << " added, " << removed << " removed, "
+             << changed << " changed.\n";
+        for (const auto& month : processedMonths)
+            if (affectedMonths.count(month)) writeMonthOutput(month);
+        return true;
+    }
+
+    // Rebuild the unknown-ID filter and picker index from the current employee master
+    void rebuildEmployeeIndexes() {
+        idFilter.reset(employees.size());
+        pickerIndex.clear();
+        idSuggestions.clear();  // The BK-tree itself is built when first needed
+        for (const auto& pair : employees) {
+            idFilter.add(pair.first);
+            pickerIndex.add(pair.first, pair.second.name);
+            idSuggestions.addAlphabet(pair.first);
+        }
+        pickerIndex.build();
+        rebuildIdOrder();
+    }
+
+    // Refill the ID-ordered employee array from the (ID-ordered) map
+    void rebuildIdOrder() {
+        employeesById.clear();
+        employeesById.reserve(employees.size());
+        for (auto& pair : employees) employeesById.emplace_back(pair.first, &pair.second);
+    }
+
+    // Derive the month from a pay file name (e.g., "jan25.txt" -> "JAN25")
+    static string monthFromFilename(const string& filename) {
+        size_t slash = filename.find_last_of('/');
+        string base = (slash == string::npos) ? filename : filename.substr(slash + 1);
+        return toUpper(base.substr(0, base.find(FileExt::TXT)));
+    }
+
+    // True for month pay file names such as "Jan25.txt" or "Jan25.txt.gz"
+    static bool isPayFileName(const string& fullName) {
+        string name = stripCompressionExt(fullName);
+        if (name.size() != 5 + FileExt::TXT.size()) return false;
+        if (toLower(name.substr(5)) != FileExt::TXT) return false;
+        return isalpha(static_cast<unsigned char>(name[0])) && isalpha(static_cast<unsigned char>(name[1]))
+            && isalpha(static_cast<unsigned char>(name[2])) && isdigit(static_cast<unsigned char>(name[3]))
+            && isdigit(static_cast<unsigned char>(name[4]));
+    }
+
+    // Clear a loaded month before it is replaced with new contents
+    void clearLoadedMonth(const string& upMonth) {
+        if (!loadedPayFiles.count(upMonth)) return;
+        removePayRecordsForMonth(upMonth);
+        loadedPayFiles.erase(upMonth);
+    }
+
+    // Log a pay file that could not be opened
+    void reportMissingPayFile(const string& filename) {
+        string err = "Pay file " + filename + " could not be found.";
+        errors.push_back({filename, err});
+        cerr << err << endl;
+        logErrors();
+    }
+
+    // Log a pay file that was found but rejected; nothing from it is applied
+    void reportRejectedPayFile(const string& filename, const string& reason) {
+        string err = "Pay file " + filename + " " + reason + "; it was not processed.";
+        errors.push_back({filename, err});
+        cerr << err << endl;
+        logErrors();
+    }
+
+    // Log a pay file that could not be read to the end (e.g. a corrupt or
+    // truncated compressed file)
+    void reportUnreadablePayFile(const string& filename) {
+        reportRejectedPayFile(filename, "could not be read completely");
+    }
+
+    // Log a binary pay file that is truncated or has an invalid header
+    void reportInvalidBinaryPayFile(const string& filename) {
+        reportRejectedPayFile(filename, "is not a valid binary pay file");
+    }
+
+    // Log the long-format lines skipped for an invalid month, per month
+    void reportInvalidMonths(const string& filename, const map<string, size_t>& invalidMonths) {
+        for (const auto& [month, lines] : invalidMonths)
+            errors.push_back({filename, to_string(lines) + " line(s) with invalid month \"" + month + "\" skipped."});
+        logErrors();
+    }
+
+    // Parse one "employee_id hours_worked" line; malformed lines are skipped
+    static void parsePayLine(const string& line, vector<PayRecord>& records) {
+        istringstream iss(line);
+        string id;
+        double hours;
+        if (iss >> id >> hours) records.push_back({toUpper(trim(id)), hours});
+    }
+
+    // Parse "employee_id hours_worked" lines, skipping malformed ones.
+    // A background load passes itself in to publish progress and to stop
+    // early when cancelled.
+    static void parsePayRecords(istream& in, vector<PayRecord>& records, BackgroundLoad* progress = nullptr) {
+        const uint64_t PROGRESS_EVERY = 4096;  // Lines between progress updates
+        string line;
+        uint64_t lines = 0, bytes = 0;
+        while (getline(in, line)) {
+            bytes += line.size() + 1;
+            if (progress && ++lines % PROGRESS_EVERY == 0) {
+                progress->linesRead = lines;
+                progress->bytesRead = bytes;
+                if (progress->cancelled) break;
+            }
+            parsePayLine(line, records);
+        }
+        if (progress) {
+            progress->linesRead = lines;
+            progress->bytesRead = bytes;
+        }
+    }
+
+    // Append the rest of a stream to `content`, publishing progress
+    static void appendStream(istream& in, string& content, BackgroundLoad* progress = nullptr) {
+        char buf[1 << 16];
+        while (in.read(buf, sizeof(buf)) || in.gcount() > 0) {
+            content.append(buf, static_cast<size_t>(in.gcount()));
+            if (progress) {
+                progress->bytesRead = content.size();
+                if (progress->cancelled) return;
+            }
+        }
+    }
+
+    // True if a pay file line is in long "employee_id month hours_worked"
+    // format, i.e. its second field is not a number of hours
+    static bool isLongFormatLine(const string& line) {
+        istringstream iss(line);
+        string id, month, hours;
+        if (!(iss >> id >> month >> hours)) return false;
+        char* end = nullptr;
+        strtod(month.c_str(), &end);
+        return *end != '\0';
+    }
+
+    // Split long-format text by month. The text is cut into chunks at line
+    // boundaries, and worker threads parse the chunks in place and route
+    // each record to its month. Lines whose month is not a calendar month
+    // (e.g. "FOO99") are counted and skipped.
+    static void splitLongFormat(const string& content, PayFileContents& out) {
+        // Chunk boundaries fall just after a newline
+        size_t workers = max(1u, thread::hardware_concurrency());
+        vector<size_t> bounds{0};
+        for (size_t w = 1; w < workers; ++w) {
+            size_t pos = content.find('\n', max(bounds.back(), content.size() * w / workers));
+            if (pos == string::npos) break;
+            bounds.push_back(pos + 1);
+        }
+        bounds.push_back(content.size());
+
+        vector<PayFileContents> parts(bounds.size() - 1);
+        vector<thread> pool;
+        for (size_t w = 0; w < parts.size(); ++w) {
+            pool.emplace_back([&, w] {
+                MemoryBuf chunk(content.data() + bounds[w], content.data() + bounds[w + 1]);
+                istream in(&chunk);
+                PayFileContents& part = parts[w];
+                string line;
+                while (getline(in, line)) {
+                    istringstream iss(line);
+                    string id, month;
+                    double hours;
+                    if (!(iss >> id >> month >> hours)) continue;  // Skip malformed lines
+                    month = toUpper(trim(month));
+                    if (monthPeriod(month) < 0) {
+                        ++part.invalidMonths[month];
+                        continue;
+                    }
+                    auto it = part.months.find(month);
+                    if (it == part.months.end()) {
+                        part.monthOrder.push_back(month);
+                        it = part.months.emplace(month, vector<PayRecord>()).first;
+                    }
+                    it->second.push_back({toUpper(trim(id)), hours});
+                }
+            });
+        }
+        for (auto& t : pool) t.join();
+
+        // Merge the partitions, keeping file order within each month
+        out.longFormat = true;
+        for (auto& part : parts) {
+            for (const auto& month : part.monthOrder) {
+                auto& dest = out.months[month];
+                if (dest.empty()) out.monthOrder.push_back(month);
+                auto& src = part.months[month];
+                dest.insert(dest.end(), make_move_iterator(src.begin()), make_move_iterator(src.end()));
+            }
+            for (const auto& [month, lines] : part.invalidMonths) out.invalidMonths[month] += lines;
+        }
+    }
+
+    // Read a pay file from a stream, telling its layout from the text
+    // itself: a binary pay file (as when one is decompressed from a .gz or
+    // .zst), whose header month replaces out.month; a long-format file
+    // whose lines carry their month; or a month file. The stream is read
+    // once. False if a binary pay file is truncated or invalid.
+    static bool readPayStream(istream& in, PayFileContents& out, BackgroundLoad* progress = nullptr) {
+        string line;
+        if (!getline(in, line)) return true;  // Empty file
+        if (BinaryPayFile::isBinary(line.data(), line.size())) {
+            string content = move(line);
+            if (!in.eof()) content += '\n';
+            appendStream(in, content, progress);
+            return BinaryPayFile::decode(content.data(), content.size(), out.month, out.records);
+        }
+        // Blank lines before the first record say nothing about the layout
+        while (trim(line).empty() && getline(in, line)) {}
+        if (isLongFormatLine(line)) {
+            string content = move(line);
+            if (!in.eof()) content += '\n';
+            appendStream(in, content, progress);
+            splitLongFormat(content, out);
+            return true;
         }
-        fin.close();
+        parsePayLine(line, out.records);
+        parsePayRecords(in, out.records, progress);
         return true;
     }
 
-    // Load pay file with hours worked for specific month
-    bool loadPayFile(const string& filename, string& outMonth, bool replace = false) {
-        // Extract month from filename (e.g., "jan25.txt" -> "JAN25")
-        string month = filename.substr(0, filename.find(FileExt::TXT));
-        string upMonth = toUpper(month);
-        outMonth = upMonth;
+    // True (with a message) if a loaded month is being resubmitted with
+    // byte-identical contents, so the file can be skipped. With
+    // evenIfNotLoaded, a month processed by an earlier run is skipped too.
+    bool skipUnchangedPayFile(const string& filename, const string& month, const FileFingerprint& fp,
+                              bool evenIfNotLoaded = false) const {
+        if ((!evenIfNotLoaded && !loadedPayFiles.count(month)) || !manifest.matches(month, fp)) return false;
+        cout << "File " << filename << " is unchanged since month " << month << " was processed; skipped.\n";
+        return true;
+    }
+
+    // Remember the contents a month was processed from
+    void recordProcessedFile(const string& month, const FileFingerprint& fp) {
+        manifest.record(month, fp);
+        saveManifest();
+    }
+
+    // Apply what was read from a pay file. Each month it holds is skipped
+    // if the manifest shows identical contents were already processed, and
+    // otherwise replaces any loaded copy. Returns the months applied.
+    vector<string> applyPayFileContents(const string& filename, const PayFileContents& contents,
+                                        const FileFingerprint& fileFp, bool skipIfProcessed = false) {
+        vector<string> applied;
+        auto applyMonth = [&](const string& month, const vector<PayRecord>& records, const FileFingerprint& fp) {
+            if (skipUnchangedPayFile(filename, month, fp, skipIfProcessed)) return;
+            clearLoadedMonth(month);
+            applyPayRecords(filename, month, records);
+            logErrors();
+            recordProcessedFile(month, fp);
+            applied.push_back(month);
+        };
+        if (!contents.longFormat) {
+            FileFingerprint fp = fileFp;
+            fp.records = contents.records.size();
+            applyMonth(contents.month, contents.records, fp);
+            return applied;
+        }
+
+        reportInvalidMonths(filename, contents.invalidMonths);
+        for (const auto& month : contents.monthOrder) {
+            const vector<PayRecord>& records = contents.months.at(month);
+            // A month's identity is the hash of its own records
+            StreamHasher hasher;
+            for (const auto& rec : records) {
+                hasher.update(rec.id.c_str(), rec.id.size() + 1);
+                hasher.update(reinterpret_cast<const char*>(&rec.hours), sizeof(rec.hours));
+            }
+            FileFingerprint fp = fileFp;
+            fp.hash = hasher.digest();
+            fp.records = records.size();
+            applyMonth(month, records, fp);
+        }
+        return applied;
+    }
+
+    // Load a pay file: one month's hours, or several months' from a
+    // long-format file. Identical resubmissions of a loaded month are
+    // skipped; changed ones replace it. The file is read once, hashed as it
+    // is parsed, and not read at all when its size and modification time
+    // show it is unchanged. Watch mode passes skipIfProcessed to skip files
+    // an earlier run processed. Returns the months applied.
+    bool loadPayFile(const string& filename, vector<string>& outMonths, bool skipIfProcessed = false) {
+        FileFingerprint fp;  // Stat'ed before reading, so a later rewrite is noticed
+        if (!ProcessedManifest::statFile(filename, fp)) {
+            reportMissingPayFile(filename);
+            return false;
+        }
+        // Binary pay files carry their month in the header
+        bool binary = BinaryPayFile::isBinaryFile(filename);
+        PayFileContents contents;
+        contents.month = monthFromFilename(filename);
+        if (binary && !BinaryPayFile::readMonth(filename, contents.month)) {
+            reportInvalidBinaryPayFile(filename);
+            return false;
+        }
+        if (manifest.knownContents(contents.month, fp) &&
+            skipUnchangedPayFile(filename, contents.month, fp, skipIfProcessed))
+            return false;
+
+        if (binary) {
+            if (!BinaryPayFile::read(filename, contents.month, contents.records, &fp.hash)) {
+                reportInvalidBinaryPayFile(filename);
+                return false;
+            }
+        } else {
+            InputFile fin(filename, true);
+            if (!fin) {
+                reportMissingPayFile(filename);
+                return false;
+            }
+            bool valid = readPayStream(fin, contents);
+            fp.hash = fin.digest();
+            if (fin.readFailed()) {
+                reportUnreadablePayFile(filename);
+                return false;
+            }
+            if (!valid) {
+                reportInvalidBinaryPayFile(filename);
+                return false;
+            }
+        }
+        outMonths = applyPayFileContents(filename, contents, fp, skipIfProcessed);
+        return !outMonths.empty();
+    }
+
+    // Sum repeated IDs (shift-level timesheet lines) into one record per
+    // employee. Each worker sums a slice of the records in its own hash map;
+    // the maps are then merged, keeping IDs in order of first appearance.
+    static vector<PayRecord> aggregateShiftRecords(const vector<PayRecord>& records) {
+        struct Slice {
+            unordered_map<string, size_t> index;  // ID -> position in sums
+            vector<PayRecord> sums;
+        };
+        size_t workers = min<size_t>(max(1u, thread::hardware_concurrency()),
+                                     max<size_t>(1, records.size() / Payroll::AGGREGATE_SLICE_RECORDS));
+        size_t perWorker = (records.size() + workers - 1) / workers;
+        vector<Slice> slices(workers);
+        auto sumSlice = [&](size_t w) {
+            Slice& slice = slices[w];
+            size_t begin = min(records.size(), w * perWorker);
+            size_t end = min(records.size(), begin + perWorker);
+            for (size_t i = begin; i < end; ++i) {
+                auto [it, added] = slice.index.emplace(records[i].id, slice.sums.size());
+                if (added) slice.sums.push_back(records[i]);
+                else slice.sums[it->second].hours += records[i].hours;
+            }
+        };
+        vector<thread> pool;
+        for (size_t w = 1; w < workers; ++w) pool.emplace_back(sumSlice, w);
+        sumSlice(0);
+        for (auto& t : pool) t.join();
+
+        Slice& total = slices[0];
+        for (size_t w = 1; w < workers; ++w) {
+            for (auto& rec : slices[w].sums) {
+                auto [it, added] = total.index.emplace(rec.id, total.sums.size());
+                if (added) total.sums.push_back(move(rec));
+                else total.sums[it->second].hours += rec.hours;
+            }
+        }
+        return move(total.sums);
+    }
+
+    // Store parsed hours against a month and register the month as processed.
+    // Errors are queued; the caller writes them with logErrors().
+    void applyPayRecords(const string& filename, const string& upMonth, const vector<PayRecord>& parsed) {
+        vector<PayRecord> aggregated;
+        if (aggregateShifts) aggregated = aggregateShiftRecords(parsed);
+        const vector<PayRecord>& records = aggregateShifts ? aggregated : parsed;
+
+        // Unknown IDs are collected first and turned into error messages once;
+        // their records are kept as they are for starters added later
+        vector<string> unknownIds;
+        vector<PayRecord>& unmatched = unmatchedRecords[upMonth];
+        vector<Employee*> paid;
+        // While IDs arrive in ascending order, merge-join them against the
+        // contiguous ID-ordered employee array. Once they don't, each ID is
+        // looked up, with the Bloom filter rejecting most unknown ones first.
+        bool sortedInput = true;
+        const string* prevId = nullptr;
+        auto cursor = employeesById.begin();
+        for (const auto& rec : records) {
+            const string& id = rec.id;
+            if (sortedInput && prevId && id < *prevId) sortedInput = false;  // Fall back to lookups
+            prevId = &id;
+            Employee* e = nullptr;
+            if (sortedInput) {
+                while (cursor != employeesById.end() && cursor->first < id) ++cursor;
+                if (cursor != employeesById.end() && cursor->first == id) e = cursor->second;
+            } else if (idFilter.mayContain(id)) {
+                auto it = employees.find(id);
+                if (it != employees.end()) e = &it->second;
+            }
+            if (e) {
+                e->hoursWorked[upMonth] = rec.hours;
+                paid.push_back(e);
+            } else {
+                unknownIds.push_back(id);
+                unmatched.push_back(rec);
+            }
+        }
+        if (unmatched.empty()) unmatchedRecords.erase(upMonth);
+        if (shardCount == 0) reportUnknownIds(filename, unknownIds);  // A shard's coordinator reports them
+        computePay(upMonth, paid);
+
+        loadedPayFiles.insert(upMonth);
+        processedMonths.push_back(upMonth);
+    }
+
+    // Month kernel: compute the pay of the given employees for a month from
+    // their hours. Inputs, including each employee's overtime tiers and
+    // parsed tax code, are gathered into columns first so that each stage
+    // is one tight loop over contiguous values. Under cumulative PAYE the
+    // tax is that due on pay so far this tax year, less the tax already
+    // paid, except for employees on a non-cumulative code.
+    void computeMonthColumns(const string& month, const vector<Employee*>& rows) {
+        size_t n = rows.size();
+        int period = monthPeriod(month);
+        bool cumulative = cumulativePaye && period >= 0;
+        const TaxBands& table = taxEngine.forPeriod(period);
+        const double elapsed = cumulative ? TaxEngine::taxMonth(period) : 1;
+        vector<double> hours(n), rate(n), gross(n), priorGross(n, 0.0), priorTax(n, 0.0), carried(n), months(n);
+        vector<double> allowance(n), taper(n), addition(n), banded(n), flatRate(n), income(n), tax(n);
+        bool statutoryRates = false;  // A D0/D1 code had no band of its own in the table
+        vector<double> loanPlan(n), ni(n), pension(n), studentLoan(n), net(n);
+        const int tiers = overtimeRules.maxTiers();
+        vector<double> tierStart(tiers * n), tierStep(tiers * n);  // Tier t of row i at [t * n + i]
+        for (size_t i = 0; i < n; ++i) {
+            const Employee& e = *rows[i];
+            hours[i] = e.hoursWorked.at(month);
+            rate[i] = e.rateAt(period);
+            const MonthPay* prior = cumulative ? e.priorPayslip(period) : nullptr;
+            if (prior) {
+                priorGross[i] = prior->ytdGross;
+                priorTax[i] = prior->ytdTax;
+            }
+            const TaxCode& code = e.taxCode;
+            carried[i] = code.nonCumulative ? 0.0 : 1.0;
+            months[i] = code.nonCumulative ? 1 : elapsed;
+            allowance[i] = code.fromTable ? table.allowance : code.allowance;
+            taper[i] = code.fromTable ? table.taperRate : 0.0;
+            addition[i] = code.addition;
+            banded[i] = code.rateClass == TaxCode::BANDED ? 1.0 : 0.0;
+            flatRate[i] = code.flatRate(table, statutoryRates);
+            loanPlan[i] = e.studentLoan ? 1.0 : 0.0;
+            const OvertimeTiers& overtime = overtimeRules.tiersFor(e.payClass);
+            for (int t = 0; t < tiers; ++t) {
+                tierStart[t * n + i] = overtime.thresholds[t];
+                tierStep[t * n + i] = overtime.steps[t];
+            }
+        }
+
+        if (statutoryRates && !warnedStatutoryRates) {
+            cerr << "Warning: The tax bands have no higher or additional rate band; D0 and D1 tax codes "
+                 << "are taxed at the statutory " << Payroll::HIGHER_TAX_RATE * 100 << "% and "
+                 << Payroll::ADDITIONAL_TAX_RATE * 100 << "% rates." << endl;
+            warnedStatutoryRates = true;
+        }
+
+        // Overtime: hours past each tier's threshold earn its multiplier step
+        // on top; classes with fewer tiers have zero steps in the rest
+        vector<double> paidHours;
+        if (tiers > 0) {
+            paidHours = hours;
+            for (int t = 0; t < tiers; ++t)
+                OvertimeRules::addTierPremium(hours.data(), tierStart.data() + t * n, tierStep.data() + t * n,
+                                              paidHours.data(), n);
+        }
+        const vector<double>& payable = tiers > 0 ? paidHours : hours;
+        for (size_t i = 0; i < n; ++i)
+            gross[i] = rate[i] * payable[i];
+
+        // Annualise this month, or the year to date over the months elapsed
+        for (size_t i = 0; i < n; ++i)
+            income[i] = (carried[i] * priorGross[i] + gross[i]) * Payroll::MONTHS_IN_YEAR / months[i] + addition[i];
+        table.annualTax(income.data(), allowance.data(), taper.data(), banded.data(), flatRate.data(), tax.data(), n);
+        for (size_t i = 0; i < n; ++i)
+            tax[i] = tax[i] * months[i] / Payroll::MONTHS_IN_YEAR - carried[i] * priorTax[i];
+        PayrollDeductions(table).run({n, gross.data(), tax.data(), loanPlan.data(), ni.data(), pension.data(),
+                                      studentLoan.data(), net.data()});
+
+        for (size_t i = 0; i < n; ++i) {
+            MonthPay& pay = rows[i]->payslips[month];
+            pay = {rate[i], hours[i], gross[i], tax[i], net[i], period,
+                   priorGross[i] + gross[i], priorTax[i] + tax[i], ni[i], pension[i], studentLoan[i], payable[i]};
+        }
+    }
+
+    // Compute a month's pay for the given employees, then any later months
+    // of theirs that depend on it
+    void computePay(const string& month, const vector<Employee*>& rows) {
+        computeMonthColumns(month, rows);
+        recomputeLaterMonths(monthPeriod(month), rows);
+    }
+
+    // Under cumulative PAYE each month's year-to-date figures feed the later
+    // months of the same tax year. Recompute those months, oldest first, for
+    // the given employees only.
+    void recomputeLaterMonths(int period, const vector<Employee*>& rows) {
+        if (!cumulativePaye || period < 0) return;
+        map<int, pair<string, vector<Employee*>>> later;  // Period -> month, employees
+        for (Employee* e : rows) {
+            for (const auto& [month, pay] : e->payslips) {
+                if (pay.period <= period || TaxEngine::taxYear(pay.period) != TaxEngine::taxYear(period)) continue;
+                later[pay.period].first = month;
+                later[pay.period].second.push_back(e);
+            }
+        }
+        for (const auto& [p, job] : later) {
+            computeMonthColumns(job.first, job.second);
+            if (loadedPayFiles.count(job.first)) restatedMonths.insert(job.first);
+        }
+    }
+
+    // Process several pay files as a pipeline: a reader thread loads file
+    // contents, a parser thread tokenizes them, this thread applies the hours
+    // and renders each report, and a writer thread saves it. Bounded queues
+    // between the stages let month N+1 be read while month N is written.
+    // A file whose size and modification time match the manifest is not
+    // read; it travels down the queues as a marker with its fingerprint.
+    void processPayFilesPipelined(const vector<string>& filenames) {
+        struct RawFile {
+            string filename;
+            string month;
+            bool found = false;
+            bool complete = false;
+            bool unchanged = false;  // The manifest knows the contents; not read
+            FileFingerprint fp;
+            string content;
+        };
+        struct ParsedFile {
+            string filename;
+            bool found = false;
+            bool complete = false;
+            bool valid = true;  // False for a truncated or invalid binary pay file
+            bool unchanged = false;
+            FileFingerprint fp;
+            PayFileContents contents;
+        };
+        struct Report { string month; string text; };
+        BoundedQueue<RawFile> rawQueue(Payroll::PIPELINE_QUEUE_DEPTH);
+        BoundedQueue<ParsedFile> parsedQueue(Payroll::PIPELINE_QUEUE_DEPTH);
+        BoundedQueue<Report> reportQueue(Payroll::PIPELINE_QUEUE_DEPTH);
+        vector<pair<string, ReportWrite>> written;  // Output file name, outcome
+
+        thread reader([&] {
+            for (const auto& fname : filenames) {
+                RawFile raw;
+                raw.filename = fname;
+                raw.month = monthFromFilename(fname);
+                if (ProcessedManifest::statFile(fname, raw.fp)) {
+                    // Whether the month is loaded is only known to the apply
+                    // stage, which makes the final decision
+                    bool monthKnown = !BinaryPayFile::isBinaryFile(fname) || BinaryPayFile::readMonth(fname, raw.month);
+                    if (monthKnown && manifest.knownContents(raw.month, raw.fp)) {
+                        raw.found = raw.complete = raw.unchanged = true;
+                        rawQueue.push(move(raw));
+                        continue;
+                    }
+                    InputFile fin(fname, true);
+                    if (fin) {
+                        raw.found = true;
+                        appendStream(fin, raw.content);
+                        raw.fp.hash = fin.digest();
+                        raw.complete = !fin.readFailed();
+                    }
+                }
+                rawQueue.push(move(raw));
+            }
+            rawQueue.close();
+        });
+        thread parser([&] {
+            RawFile raw;
+            while (rawQueue.pop(raw)) {
+                ParsedFile parsed;
+                parsed.filename = raw.filename;
+                parsed.found = raw.found;
+                parsed.complete = raw.complete;
+                parsed.unchanged = raw.unchanged;
+                parsed.fp = raw.fp;
+                parsed.contents.month = raw.month;
+                if (!raw.unchanged) {
+                    MemoryBuf content(raw.content.data(), raw.content.data() + raw.content.size());
+                    istream in(&content);
+                    parsed.valid = readPayStream(in, parsed.contents);
+                }
+                parsedQueue.push(move(parsed));
+            }
+            parsedQueue.close();
+        });
+        thread writer([&] {
+            Report rep;
+            while (reportQueue.pop(rep)) {
+                string fname = monthOutputName(rep.month);
+                written.push_back({fname, saveMonthReport(fname, rep.text)});
+            }
+        });
+
+        auto queueReports = [&](const string& filename, const vector<string>& months) {
+            for (const auto& month : months) {
+                cout << "File " << filename << " processed successfully as month " << month << ".\n";
+                ostringstream report;
+                writeMonthRows(report, month);
+                restatedMonths.erase(month);
+                reportQueue.push({month, report.str()});
+            }
+        };
+        ParsedFile parsed;
+        while (parsedQueue.pop(parsed)) {
+            if (parsed.unchanged) {
+                // Skipped if its month is still loaded; otherwise it is read now
+                if (!skipUnchangedPayFile(parsed.filename, parsed.contents.month, parsed.fp)) {
+                    vector<string> months;
+                    loadPayFile(parsed.filename, months);
+                    queueReports(parsed.filename, months);
+                }
+                continue;
+            }
+            if (!parsed.found) {
+                reportMissingPayFile(parsed.filename);
+                continue;
+            }
+            if (!parsed.complete) {
+                reportUnreadablePayFile(parsed.filename);
+                continue;
+            }
+            if (!parsed.valid) {
+                reportInvalidBinaryPayFile(parsed.filename);
+                continue;
+            }
+            queueReports(parsed.filename, applyPayFileContents(parsed.filename, parsed.contents, parsed.fp));
+        }
+        reportQueue.close();
+        reader.join();
+        parser.join();
+        writer.join();
+
+        for (const auto& [fname, result] : written) reportWriteResult(fname, result);
+        saveManifest();
+        // Reports rendered before a later file in the batch restated them
+        writeRestatedMonths();
+    }
+
+    // Error text for an unknown ID, naming the closest valid IDs if any
+    static string unknownIdMessage(const string& id, const vector<string>& near) {
+        string message = id + " is not a valid employee ID number.";
+        for (size_t i = 0; i < near.size(); ++i)
+            message += (i == 0 ? " Did you mean " : ", ") + near[i];
+        if (!near.empty()) message += "?";
+        return message;
+    }
+
+    // Valid IDs to suggest for an unknown one, and how many edits away they are
+    struct IdSuggestion {
+        vector<string> ids;
+        int distance = 1;
+    };
+
+    // Suggestions for each of the distinct unknown IDs, looked up in
+    // parallel. Most typos are one edit out and are matched against the ID
+    // filter; the BK-tree is only built and searched for the rest.
+    vector<IdSuggestion> suggestIds(const vector<string>& distinct) {
+        vector<IdSuggestion> near(distinct.size());
+        auto forEachDistinct = [&](const function<void(size_t)>& lookup) {
+            size_t workers = min<size_t>(max(1u, thread::hardware_concurrency()), distinct.size());
+            atomic<size_t> next{0};
+            auto work = [&] {
+                for (size_t i; (i = next++) < distinct.size(); ) lookup(i);
+            };
+            vector<thread> pool;
+            for (size_t w = 1; w < workers; ++w) pool.emplace_back(work);
+            work();
+            for (auto& t : pool) t.join();
+        };
+        auto known = [this](const string& candidate) {
+            return idFilter.mayContain(candidate) && employees.count(candidate) > 0;
+        };
+        forEachDistinct([&](size_t i) {
+            near[i].ids = idSuggestions.oneEditAway(distinct[i], known, Payroll::ID_SUGGESTION_LIMIT);
+        });
+        bool anyMissed = any_of(near.begin(), near.end(), [](const IdSuggestion& n) { return n.ids.empty(); });
+        if (anyMissed && Payroll::ID_SUGGESTION_MAX_EDITS > 1) {
+            if (idSuggestions.empty()) {
+                vector<string> ids;
+                ids.reserve(employees.size());
+                for (const auto& pair : employees) ids.push_back(pair.first);
+                idSuggestions.build(ids);
+            }
+            forEachDistinct([&](size_t i) {
+                if (near[i].ids.empty())
+                    near[i].ids = idSuggestions.closest(distinct[i], Payroll::ID_SUGGESTION_MAX_EDITS,
+                                                        Payroll::ID_SUGGESTION_LIMIT, &near[i].distance);
+            });
+        }
+        return near;
+    }
+
+    // Queue an error for each unknown ID, suggesting the nearest valid IDs.
+    // Each distinct ID is looked up once.
+    void reportUnknownIds(const string& filename, const vector<string>& unknownIds) {
+        if (unknownIds.empty()) return;
+        unordered_map<string, size_t> index;  // ID -> position in distinct
+        vector<string> distinct;
+        for (const auto& id : unknownIds)
+            if (index.emplace(id, distinct.size()).second) distinct.push_back(id);
+        vector<IdSuggestion> near = suggestIds(distinct);
+
+        errors.reserve(errors.size() + unknownIds.size());
+        for (const auto& id : unknownIds)
+            errors.push_back({filename, unknownIdMessage(id, near[index[id]].ids)});
+    }
+
+    // Remove pay records for a specific month (used when replacing data)
+    void removePayRecordsForMonth(const string& month) {
+        vector<Employee*> affected;
+        for (auto& pair : employees) {
+            pair.second.hoursWorked.erase(month);
+            if (pair.second.payslips.erase(month)) affected.push_back(&pair.second);
+        }
+        recomputeLaterMonths(monthPeriod(month), affected);
+        unmatchedRecords.erase(month);
+        auto it = find(processedMonths.begin(), processedMonths.end(), month);
+        if (it != processedMonths.end()) processedMonths.erase(it);
+    }
+
+    // Write one employee's report row for a month. With overtime rules, a
+    // Paid Hrs column shows the hours gross is paid on. When tax_bands.txt
+    // sets deductions, NI, pension and student loan columns sit between Tax
+    // and Net so the row adds up.
+    void writeEmployeeRow(ostream& out, const Employee& e, const string& month) const {
+        // Column width constants for consistent formatting
+        const int w_id    = 8;
+        const int w_name  = 18;
+        const int w_rate  = 10;
+        const int w_hours = 8;
+        const int w_paid  = 10;
+        const int w_gross = 12;
+        const int w_tax   = 10;
+        const int w_ni    = 10;
+        const int w_pension = 12;
+        const int w_loan  = 10;
+        const int w_net   = 12;
+
+        const MonthPay& pay = e.payslips.at(month);
+        out << left << setw(w_id) << e.id
+            << left << setw(w_name) << e.name
+            << right << setw(w_rate) << fixed << setprecision(2) << pay.rate
+            << right << setw(w_hours) << fixed << setprecision(2) << pay.hours;
+        if (overtimeRules.maxTiers() > 0) out << right << setw(w_paid) << fixed << setprecision(2) << pay.paidHours;
+        out << right << setw(w_gross) << fixed << setprecision(2) << pay.gross
+            << right << setw(w_tax) << fixed << setprecision(2) << pay.tax;
+        if (taxEngine.hasDeductions()) {
+            out << right << setw(w_ni) << fixed << setprecision(2) << pay.ni
+                << right << setw(w_pension) << fixed << setprecision(2) << pay.pension
+                << right << setw(w_loan) << fixed << setprecision(2) << pay.studentLoan;
+        }
+        out << right << setw(w_net) << fixed << setprecision(2) << pay.net << '\n';
+    }
+
+    // Write the month report (header plus one row per employee) to a stream
+    void writeMonthRows(ostream& out, const string& month) const {
+        printAlignedHeader(out);
+        for (const auto& pair : employees)
+            if (pair.second.payslips.count(month)) writeEmployeeRow(out, pair.second, month);
+    }
+
+    // Save a rendered month report to disk, unless the existing file
+    // already has the same contents. The report is written to a temporary
+    // file and renamed into place, so readers never see a partial report.
+    ReportWrite saveMonthReport(const string& fname, const string& text) {
+        string compressed;
+        if (!outputCompression.empty() && !compressParallel(outputCompression, text, compressed))
+            return ReportWrite::FAILED;
+        const string& bytes = outputCompression.empty() ? text : compressed;
+
+        uint64_t hash = hashBytes(bytes.data(), bytes.size());
+        if (manifest.reportUnchanged(fname, bytes.size(), hash)) return ReportWrite::UNCHANGED;
+        string tmp = fname + ".tmp";
+        ofstream fout(tmp, ios::binary);
+        if (!fout) return ReportWrite::FAILED;
+        fout << bytes;
+        fout.close();
+        if (!fout || rename(tmp.c_str(), fname.c_str()) != 0) {
+            unlink(tmp.c_str());
+            return ReportWrite::FAILED;
+        }
+        manifest.recordReport(fname, hash);
+        return ReportWrite::WRITTEN;
+    }
+
+    // Tell the user what happened to a month report
+    void reportWriteResult(const string& fname, ReportWrite result) const {
+        switch (result) {
+            case ReportWrite::WRITTEN: cout << "Wrote pay details to " << fname << endl; break;
+            case ReportWrite::UNCHANGED: cout << "Pay details in " << fname << " are unchanged; not rewritten." << endl; break;
+            case ReportWrite::FAILED: cerr << "Error: Cannot write to " << fname << endl; break;
+        }
+    }
+
+    void saveManifest() const {
+        if (!manifest.save()) cerr << "Error: Cannot write to " << FileNames::MANIFEST_FILE << endl;
+    }
+
+    // Write a large month report with several threads. Rows are fixed-width,
+    // so each worker formats a disjoint range of rows and pwrite()s it at its
+    // precomputed offset in a preallocated temporary file, which is then
+    // renamed into place. Returns false, leaving the file untouched, if the
+    // report is small or any row overflows a column.
+    bool writeMonthOutputParallel(const string& fname, const string& month, ReportWrite& result) {
+        const int w_id    = 8;
+        const int w_name  = 18;
+        const int w_rate  = 10;
+        const int w_hours = 8;
+        const int w_paid  = 10;
+        const int w_gross = 12;
+        const int w_tax   = 10;
+        const int w_ni    = 10;
+        const int w_pension = 12;
+        const int w_loan  = 10;
+        const int w_net   = 12;
+        const bool overtime = overtimeRules.maxTiers() > 0;
+        const bool deductions = taxEngine.hasDeductions();
+        const size_t ROW_BYTES = w_id + w_name + w_rate + w_hours + w_gross + w_tax + w_net + 1
+                                 + (overtime ? w_paid : 0) + (deductions ? w_ni + w_pension + w_loan : 0);
+
+        vector<pair<const Employee*, const MonthPay*>> rows;
+        for (const auto& pair : employees) {
+            auto it = pair.second.payslips.find(month);
+            if (it != pair.second.payslips.end()) rows.push_back({&pair.second, &it->second});
+        }
+        if (rows.size() < Payroll::PARALLEL_WRITE_MIN_ROWS) return false;
+
+        ostringstream header;
+        printAlignedHeader(header);
+        const string headerText = header.str();
 
-        // Check for duplicate processing
-        if (loadedPayFiles.count(upMonth) && !replace) {
-            char choice = getYesNoInput("This file has already been processed.\nDo you want to replace it? (y/n): ");
-            if (choice == Inputs::YES) {
-                removePayRecordsForMonth(upMonth);
-                loadedPayFiles.erase(upMonth);
-            } else {
-                return false;
-            }
+        // Phase 1: format rows into per-worker buffers, checking every width
+        size_t workers = max(1u, thread::hardware_concurrency());
+        size_t perWorker = (rows.size() + workers - 1) / workers;
+        vector<string> chunks(workers);
+        atomic<bool> overflow(false);
+        vector<thread> pool;
+        for (size_t w = 0; w < workers; ++w) {
+            pool.emplace_back([&, w] {
+                size_t begin = min(rows.size(), w * perWorker);
+                size_t end = min(rows.size(), begin + perWorker);
+                string& buf = chunks[w];
+                buf.resize((end - begin) * ROW_BYTES);
+                char line[256];
+                for (size_t i = begin; i < end && !overflow; ++i) {
+                    const Employee& e = *rows[i].first;
+                    const MonthPay& pay = *rows[i].second;
+                    int n = snprintf(line, sizeof(line), "%-*s%-*s%*.2f%*.2f", w_id, e.id.c_str(),
+                                     w_name, e.name.c_str(), w_rate, pay.rate, w_hours, pay.hours);
+                    // Further columns stop being added once the line is full
+                    auto column = [&](int width, double value) {
+                        if (n >= 0 && static_cast<size_t>(n) < sizeof(line))
+                            n += snprintf(line + n, sizeof(line) - n, "%*.2f", width, value);
+                    };
+                    if (overtime) column(w_paid, pay.paidHours);
+                    column(w_gross, pay.gross);
+                    column(w_tax, pay.tax);
+                    if (deductions) {
+                        column(w_ni, pay.ni);
+                        column(w_pension, pay.pension);
+                        column(w_loan, pay.studentLoan);
+                    }
+                    column(w_net, pay.net);
+                    if (n >= 0 && static_cast<size_t>(n) + 1 < sizeof(line)) line[n++] = '\n';
+                    if (n != static_cast<int>(ROW_BYTES)) {
+                        overflow = true;
+                        break;
+                    }
+                    memcpy(&buf[(i - begin) * ROW_BYTES], line, ROW_BYTES);
+                }
+            });
         }
+        for (auto& t : pool) t.join();
+        if (overflow) return false;
 
-        ifstream fin(filename);
-        if (!fin) {
-            string err = "Pay file " + filename + " could not be found.";
-            errors.push_back({filename, err});
-            cerr << err << endl;
-            logErrors();
+        // Leave the existing report alone if its contents would not change
+        StreamHasher hasher;
+        hasher.update(headerText.data(), headerText.size());
+        for (const auto& chunk : chunks) hasher.update(chunk.data(), chunk.size());
+        uint64_t hash = hasher.digest();
+        off_t total = static_cast<off_t>(headerText.size() + rows.size() * ROW_BYTES);
+        if (manifest.reportUnchanged(fname, total, hash)) {
+            result = ReportWrite::UNCHANGED;
+            return true;
+        }
+
+        string tmp = fname + ".tmp";
+        int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+        bool ok = ftruncate(fd, total) == 0
+               && pwrite(fd, headerText.data(), headerText.size(), 0) == static_cast<ssize_t>(headerText.size());
+
+        // Phase 2: each worker writes its chunk at its row offset
+        atomic<bool> writeFailed(false);
+        pool.clear();
+        for (size_t w = 0; ok && w < workers; ++w) {
+            if (chunks[w].empty()) continue;
+            pool.emplace_back([&, w] {
+                off_t offset = static_cast<off_t>(headerText.size() + w * perWorker * ROW_BYTES);
+                const char* data = chunks[w].data();
+                size_t left = chunks[w].size();
+                while (left > 0) {
+                    ssize_t n = pwrite(fd, data, left, offset);
+                    if (n <= 0) {
+                        writeFailed = true;
+                        return;
+                    }
+                    data += n;
+                    left -= n;
+                    offset += n;
+                }
+            });
+        }
+        for (auto& t : pool) t.join();
+        ok = ok && !writeFailed;
+        ok = (close(fd) == 0) && ok;
+        if (!ok || rename(tmp.c_str(), fname.c_str()) != 0) {
+            unlink(tmp.c_str());
             return false;
         }
+        manifest.recordReport(fname, hash);
+        result = ReportWrite::WRITTEN;
+        return true;
+    }
 
-        // Process each line: employee_id hours_worked
-        string line;
-        while (getline(fin, line)) {
-            istringstream iss(line);
-            string id;
-            double hours;
-            if (!(iss >> id >> hours)) continue;  // Skip malformed lines
-            id = toUpper(trim(id));
-            if (employees.count(id))
-                employees[id].hoursWorked[upMonth] = hours;
-            else
-                errors.push_back({filename, id + " is not a valid employee ID number."});
+    // Sum repeated employee lines within a month instead of keeping the last
+    void setAggregateShifts(bool enabled) {
+        aggregateShifts = enabled;
+    }
+
+    // Tax each month on year-to-date pay within its tax year
+    void setCumulativePaye(bool enabled) {
+        cumulativePaye = enabled;
+    }
+
+    // Memory budget for rankings, in bytes or with a K, M or G suffix (e.g.
+    // "256M"); false if not a positive size
+    bool setSortBudget(const string& text) {
+        char* end = nullptr;
+        unsigned long long value = strtoull(text.c_str(), &end, 10);
+        if (end == text.c_str() || text[0] == '-') return false;
+        int shift = 0;
+        switch (toupper(static_cast<unsigned char>(*end))) {
+            case '\0': break;
+            case 'K': shift = 10; break;
+            case 'M': shift = 20; break;
+            case 'G': shift = 30; break;
+            default: return false;
         }
+        if (*end && end[1]) return false;
+        if (value == 0 || value > (numeric_limits<size_t>::max() >> shift)) return false;
+        sortBudget = static_cast<size_t>(value) << shift;
+        return true;
+    }
 
-        loadedPayFiles.insert(upMonth);
-        processedMonths.push_back(upMonth);
-        fin.close();
-        logErrors();
+    // Compress month reports from now on ("gz" or "zst"); false if unsupported
+    bool setOutputCompression(const string& format) {
+        string ext = "." + toLower(format);
+        if (!compressorFor(ext)) return false;
+        outputCompression = ext;
         return true;
     }
 
-    // Remove pay records for a specific month (used when replacing data)
-    void removePayRecordsForMonth(const string& month) {
-        for (auto& pair : employees)
-            pair.second.hoursWorked.erase(month);
-        auto it = find(processedMonths.begin(), processedMonths.end(), month);
-        if (it != processedMonths.end()) processedMonths.erase(it);
+    // Report file name for a month, e.g. "jan25_output.txt(.gz)"
+    string monthOutputName(const string& month) const {
+        return toLower(month) + FileNames::OUTPUT_SUFFIX + outputCompression;
     }
 
     // Write payroll summary to output file
     void writeMonthOutput(const string& month) {
-        string fname = toLower(month) + FileNames::OUTPUT_SUFFIX;
-        ofstream fout(fname);
-        if (!fout) {
-            cerr << "Error: Cannot write to " << fname << endl;
-            return;
+        string fname = monthOutputName(month);
+        ReportWrite result;
+        // Compressed reports are rendered whole and compressed in blocks
+        if (!outputCompression.empty() || !writeMonthOutputParallel(fname, month, result)) {
+            ostringstream report;
+            writeMonthRows(report, month);
+            result = saveMonthReport(fname, report.str());
         }
+        reportWriteResult(fname, result);
+        saveManifest();
+        restatedMonths.erase(month);
+        writeRestatedMonths();
+    }
 
-        // Column width constants for consistent formatting
-        const int w_id    = 8;
-        const int w_name  = 18;
-        const int w_rate  = 10;
-        const int w_hours = 8;
-        const int w_gross = 12;
-        const int w_tax   = 10;
-        const int w_net   = 12;
-
-        // Write header
-        printAlignedHeader(fout);
-
-        // Write employee data for this month
-        for (const auto& pair : employees) {
-            const Employee& e = pair.second;
-            if (e.hoursWorked.count(month)) {
-                fout << left << setw(w_id) << e.id
-                     << left << setw(w_name) << e.name
-                     << right << setw(w_rate) << fixed << setprecision(2) << e.hourlyRate
-                     << right << setw(w_hours) << fixed << setprecision(2) << e.hoursWorked.at(month)
-                     << right << setw(w_gross) << fixed << setprecision(2) << e.getGrossPay(month)
-                     << right << setw(w_tax) << fixed << setprecision(2) << e.getTax(month)
-                     << right << setw(w_net) << fixed << setprecision(2) << e.getNetPay(month) << endl;
-            }
+    // Bring written reports restated by later figures under cumulative PAYE up to date
+    void writeRestatedMonths() {
+        while (!restatedMonths.empty()) {
+            string restated = *restatedMonths.begin();
+            restatedMonths.erase(restatedMonths.begin());
+            writeMonthOutput(restated);
         }
-        fout.close();
-        cout << "Wrote pay details to " << fname << endl;
     }
 
     // Write errors to log file
@@ -357,14 +3239,6 @@ public:
     // =============== Organized Display Functions ===============
     // Display payroll summary for a specific month
     void printMonthSummary(const string& month) {
-        const int w_id    = 8;
-        const int w_name  = 18;
-        const int w_rate  = 10;
-        const int w_hours = 8;
-        const int w_gross = 12;
-        const int w_tax   = 10;
-        const int w_net   = 12;
-
         cout << "\n";
         printLine(HEADER_TOTAL_WIDTH);
         cout << "Monthly Summary: " << month << "\n";
@@ -373,39 +3247,59 @@ public:
         printShortLine(HEADER_TOTAL_WIDTH);
 
         // Display each employee who worked this month
-        for (const auto& [_, emp] : employees) {
-            if (emp.hoursWorked.count(month)) {
-                cout << left << setw(w_id) << emp.id
-                     << left << setw(w_name) << emp.name
-                     << right << setw(w_rate) << fixed << setprecision(2) << emp.hourlyRate
-                     << right << setw(w_hours) << fixed << setprecision(2) << emp.hoursWorked.at(month)
-                     << right << setw(w_gross) << fixed << setprecision(2) << emp.getGrossPay(month)
-                     << right << setw(w_tax) << fixed << setprecision(2) << emp.getTax(month)
-                     << right << setw(w_net) << fixed << setprecision(2) << emp.getNetPay(month) << endl;
-            }
-        }
+        for (const auto& [_, emp] : employees)
+            if (emp.hoursWorked.count(month)) writeEmployeeRow(cout, emp, month);
         printLine(HEADER_TOTAL_WIDTH);
     }
 
-    // Show employee selection menu for detailed breakdown
-    void showEmployeeBreakdown() {
-        vector<string> idList;
-        int count = 1;
-        printShortLine(LINE_TOTAL_WIDTH);
-        cout << "Select Employee\n";
-        printShortLine(LINE_TOTAL_WIDTH);
+    // Prompt for an ID or name prefix and page through the matching employees.
+    // Returns the chosen ID, or an empty string to return to the menu.
+    string pickEmployee(const string& title) {
+        const size_t pageSize = Payroll::PICKER_PAGE_SIZE;
+        string prefix;
+        size_t page = 0;
+        while (true) {
+            auto [first, last] = pickerIndex.find(prefix);
+            size_t matches = static_cast<size_t>(last - first);
+            size_t pages = max<size_t>(1, (matches + pageSize - 1) / pageSize);
+            page = min(page, pages - 1);
+            size_t start = page * pageSize;
+            size_t end = min(matches, start + pageSize);
+
+            printShortLine(LINE_TOTAL_WIDTH);
+            cout << title;
+            if (!prefix.empty()) cout << " matching \"" << prefix << "\"";
+            cout << " (" << matches << " found, page " << page + 1 << " of " << pages << ")\n";
+            printShortLine(LINE_TOTAL_WIDTH);
+            for (size_t i = start; i < end; ++i) {
+                const Employee& emp = employees.at(first[i].id);
+                cout << setw(3) << (i - start + 1) << ". " << emp.id << " (" << emp.name << ")\n";
+            }
+            if (matches == 0) cout << "No matching employees.\n";
+            printShortLine(LINE_TOTAL_WIDTH);
 
-        // Build numbered list of employees
-        for (const auto& [id, emp] : employees) {
-            cout << setw(3) << count << ". " << emp.id << " (" << emp.name << ")\n";
-            idList.push_back(id);
-            ++count;
+            string input = trim(getStringInput("Select by number, type an ID or name prefix, '" + Inputs::NEXT_PAGE +
+                                               "'/'" + Inputs::PREV_PAGE + "' to page (or 0 to return): "));
+            if (!cin || input == Inputs::RETURN) return "";
+            if (input == Inputs::NEXT_PAGE) {
+                if (page + 1 < pages) ++page;
+            } else if (input == Inputs::PREV_PAGE) {
+                if (page > 0) --page;
+            } else if (!input.empty() && all_of(input.begin(), input.end(), [](char c) { return isdigit(static_cast<unsigned char>(c)); })) {
+                size_t sel = strtoul(input.c_str(), nullptr, 10);
+                if (sel >= 1 && sel <= end - start) return first[start + sel - 1].id;
+                cout << "Invalid selection. Please enter a number between 1 and " << end - start << ".\n";
+            } else {
+                prefix = toUpper(input);  // Empty input lists everyone again
+                page = 0;
+            }
         }
-        printShortLine(LINE_TOTAL_WIDTH);
+    }
 
-        int sel = getIntInput(0, static_cast<int>(idList.size()), "Select employee by number (or 0 to return): ");
-        if (sel <= 0 || sel > static_cast<int>(idList.size())) return;
-        displayEmployeeDetails(idList[sel - 1]);
+    // Show employee picker for detailed breakdown
+    void showEmployeeBreakdown() {
+        string id = pickEmployee("Select Employee");
+        if (!id.empty()) displayEmployeeDetails(id);
     }
 
     // Display detailed breakdown for individual employee
@@ -420,6 +3314,7 @@ public:
         // Column widths for employee detail table
         const int w_month = 12;
         const int w_hours = 8;
+        const int w_paid = 10;
         const int w_gross = 19;
         const int w_tax = 22;
         const int w_net = 25;
@@ -430,9 +3325,11 @@ public:
         printShortLine(60);
 
         // Table header
+        const bool overtime = overtimeRules.maxTiers() > 0;  // Gross is paid on more hours than worked
         cout << left  << setw(w_month) << "Month"
-             << right << setw(w_hours) << "Hours"
-             << right << setw(w_gross) << "Gross(£)"
+             << right << setw(w_hours) << "Hours";
+        if (overtime) cout << right << setw(w_paid) << "Paid Hrs";
+        cout << right << setw(w_gross) << "Gross(£)"
              << right << setw(w_tax)   << "Tax(£)"
              << right << setw(w_net)   << "Net(£)" << endl;
         printShortLine(60);
@@ -443,8 +3340,9 @@ public:
             const string& month = rec.first;
             double hours = rec.second;
             cout << left  << setw(w_month) << month
-                 << right << setw(w_hours) << fixed << setprecision(2) << hours
-                 << right << setw(w_gross) << CURRENCY << fixed << setprecision(2) << e.getGrossPay(month)
+                 << right << setw(w_hours) << fixed << setprecision(2) << hours;
+            if (overtime) cout << right << setw(w_paid) << fixed << setprecision(2) << e.payslips.at(month).paidHours;
+            cout << right << setw(w_gross) << CURRENCY << fixed << setprecision(2) << e.getGrossPay(month)
                  << right << setw(w_tax)   << CURRENCY << fixed << setprecision(2) << e.getTax(month)
                  << right << setw(w_net)   << CURRENCY << fixed << setprecision(2) << e.getNetPay(month) << endl;
             totalGross += e.getGrossPay(month);
@@ -455,43 +3353,861 @@ public:
         // Display totals row
         printShortLine(60);
         cout << left  << setw(w_month) << "Totals:"
-             << right << setw(w_hours) << "" // empty for hours column
-             << right << setw(w_gross) << CURRENCY << fixed << setprecision(2) << totalGross
+             << right << setw(w_hours) << ""; // empty for hours column
+        if (overtime) cout << right << setw(w_paid) << "";
+        cout << right << setw(w_gross) << CURRENCY << fixed << setprecision(2) << totalGross
              << right << setw(w_tax)   << CURRENCY << fixed << setprecision(2) << totalTax
              << right << setw(w_net)   << CURRENCY << fixed << setprecision(2) << totalNet << endl;
+        double ni, pension, studentLoan;
+        e.getTotalDeductions(ni, pension, studentLoan);
+        if (ni != 0.0 || pension != 0.0 || studentLoan != 0.0) {  // Only when tax_bands.txt sets them
+            cout << "Also deducted: NI " << CURRENCY << fixed << setprecision(2) << ni
+                 << ", pension " << CURRENCY << pension << ", student loan " << CURRENCY << studentLoan << endl;
+        }
         printLine(60);
     }
 
     // Display employee totals summary
     void showEmployeeTotals() {
-        vector<string> idList;
-        int count = 1;
-        printShortLine(LINE_TOTAL_WIDTH);
-        cout << "Employee List\n";
-        printShortLine(LINE_TOTAL_WIDTH);
-
-        // Build employee selection list
-        for (const auto& [id, emp] : employees) {
-            cout << setw(3) << count << ". " << emp.id << " (" << emp.name << ")\n";
-            idList.push_back(id);
-            ++count;
-        }
-        printShortLine(LINE_TOTAL_WIDTH);
-
-        int sel = getIntInput(0, static_cast<int>(idList.size()), "Select employee by number (or 0 to return): ");
-        if (sel <= 0 || sel > static_cast<int>(idList.size())) return;
+        string id = pickEmployee("Employee List");
+        if (id.empty()) return;
 
         // Display summary totals for selected employee
-        const Employee& e = employees[idList[sel - 1]];
+        const Employee& e = employees.at(id);
         printLine(LINE_TOTAL_WIDTH);
         cout << "Totals for " << e.id << " (" << e.name << "):\n";
         printShortLine(LINE_TOTAL_WIDTH);
         cout << left << setw(16) << "Total Gross:" << CURRENCY << fixed << setprecision(2) << e.getTotalGross() << endl;
         cout << left << setw(16) << "Total Tax:" << CURRENCY << fixed << setprecision(2) << e.getTotalTax() << endl;
+        if (taxEngine.hasDeductions()) {
+            double ni, pension, studentLoan;
+            e.getTotalDeductions(ni, pension, studentLoan);
+            cout << left << setw(16) << "Total NI:" << CURRENCY << fixed << setprecision(2) << ni << endl;
+            cout << left << setw(16) << "Total Pension:" << CURRENCY << fixed << setprecision(2) << pension << endl;
+            cout << left << setw(16) << "Total Loan:" << CURRENCY << fixed << setprecision(2) << studentLoan << endl;
+        }
         cout << left << setw(16) << "Total Net:" << CURRENCY << fixed << setprecision(2) << e.getTotalNet() << endl;
         printLine(LINE_TOTAL_WIDTH);
     }
 
+    // JSON fields for NI, pension and student loan deductions, when
+    // tax_bands.txt sets any, so that gross - tax - these = net
+    string deductionFields(double ni, double pension, double studentLoan) const {
+        if (!taxEngine.hasDeductions()) return "";
+        ostringstream out;
+        out << fixed << setprecision(2) << ",\"ni\":" << ni << ",\"pension\":" << pension
+            << ",\"student_loan\":" << studentLoan;
+        return out.str();
+    }
+
+    string deductionFields(const Employee& e, const string& month) const {
+        const MonthPay& pay = e.payslips.at(month);
+        return deductionFields(pay.ni, pay.pension, pay.studentLoan);
+    }
+
+    // JSON field for the hours a month's gross is paid on, when overtime rules exist
+    string paidHoursField(const Employee& e, const string& month) const {
+        if (overtimeRules.maxTiers() == 0) return "";
+        ostringstream out;
+        out << fixed << setprecision(2) << ",\"paid_hours\":" << e.payslips.at(month).paidHours;
+        return out.str();
+    }
+
+    // Answer one query-service request with a single line of JSON.
+    // Requests: "months", "summary <MONTH>", "employee <ID>",
+    // "totals <ID>", "rank <MONTH> rate|hours|net".
+    string handleQuery(const string& request) const {
+        istringstream iss(request);
+        string cmd, arg, crit;
+        iss >> cmd >> arg >> crit;
+        cmd = toLower(cmd);
+        arg = toUpper(arg);
+        ostringstream out;
+        out << fixed << setprecision(2);
+
+        if (cmd == "months") {
+            out << "{\"months\":[";
+            for (size_t i = 0; i < processedMonths.size(); ++i)
+                out << (i ? "," : "") << '"' << jsonEscape(processedMonths[i]) << '"';
+            out << "]}";
+        } else if (cmd == "summary") {
+            if (!loadedPayFiles.count(arg)) return "{\"error\":\"unknown month\"}";
+            out << "{\"month\":\"" << jsonEscape(arg) << "\",\"employees\":[";
+            bool first = true;
+            for (const auto& [id, e] : employees) {
+                auto hrs = e.hoursWorked.find(arg);
+                if (hrs == e.hoursWorked.end()) continue;
+                out << (first ? "" : ",") << "{\"id\":\"" << jsonEscape(id)
+                    << "\",\"name\":\"" << jsonEscape(e.name)
+                    << "\",\"rate\":" << e.rateFor(arg) << ",\"hours\":" << hrs->second
+                    << paidHoursField(e, arg) << ",\"gross\":" << e.getGrossPay(arg) << ",\"tax\":" << e.getTax(arg)
+                    << deductionFields(e, arg) << ",\"net\":" << e.getNetPay(arg) << "}";
+                first = false;
+            }
+            out << "]}";
+        } else if (cmd == "employee" || cmd == "totals") {
+            auto it = employees.find(arg);
+            if (it == employees.end()) return "{\"error\":\"unknown employee\"}";
+            const Employee& e = it->second;
+            out << "{\"id\":\"" << jsonEscape(e.id) << "\",\"name\":\"" << jsonEscape(e.name) << "\"";
+            if (cmd == "employee") {
+                out << ",\"rate\":" << e.currentRate() << ",\"months\":[";
+                bool first = true;
+                for (const auto& [month, hours] : e.hoursWorked) {
+                    out << (first ? "" : ",") << "{\"month\":\"" << jsonEscape(month)
+                        << "\",\"hours\":" << hours << paidHoursField(e, month) << ",\"gross\":" << e.getGrossPay(month)
+                        << ",\"tax\":" << e.getTax(month) << deductionFields(e, month)
+                        << ",\"net\":" << e.getNetPay(month) << "}";
+                    first = false;
+                }
+                out << "]}";
+            } else {
+                double ni, pension, studentLoan;
+                e.getTotalDeductions(ni, pension, studentLoan);
+                out << ",\"gross\":" << e.getTotalGross() << ",\"tax\":" << e.getTotalTax()
+                    << deductionFields(ni, pension, studentLoan) << ",\"net\":" << e.getTotalNet() << "}";
+            }
+        } else if (cmd == "rank") {
+            if (!loadedPayFiles.count(arg)) return "{\"error\":\"unknown month\"}";
+            crit = toLower(crit);
+            if (crit != "rate" && crit != "hours" && crit != "net") return "{\"error\":\"unknown sort key\"}";
+            ExternalSorter sorter(sortBudget);
+            for (const auto& [id, e] : employees) {
+                auto hrs = e.hoursWorked.find(arg);
+                if (hrs == e.hoursWorked.end()) continue;
+                if (crit == "rate") sorter.add(e.rateFor(arg), id);
+                else if (crit == "hours") sorter.add(hrs->second, id);
+                else sorter.add(e.getNetPay(arg), id);
+            }
+            out << "{\"month\":\"" << jsonEscape(arg) << "\",\"by\":\"" << crit << "\",\"employees\":[";
+            bool first = true;
+            bool complete = sorter.forEachSorted([&](const ExternalSorter::Record& r) {
+                out << (first ? "" : ",") << "{\"id\":\"" << jsonEscape(r.id) << "\",\"value\":" << r.key << "}";
+                first = false;
+            });
+            if (!complete) return "{\"error\":\"sort failed\"}";
+            out << "]}";
+        } else {
+            return "{\"error\":\"unknown request\"}";
+        }
+        return out.str();
+    }
+
+    // Answer one connection's queries until it closes or a reply cannot be sent
+    void serveConnection(int client) {
+        string pending;
+        char buf[4096];
+        ssize_t n;
+        while ((n = read(client, buf, sizeof(buf))) > 0) {
+            pending.append(buf, n);
+            size_t nl;
+            while ((nl = pending.find('\n')) != string::npos) {
+                string reply = handleQuery(trim(pending.substr(0, nl))) + "\n";
+                pending.erase(0, nl + 1);
+                for (size_t sent = 0; sent < reply.size(); ) {
+                    ssize_t w = send(client, reply.data() + sent, reply.size() - sent, MSG_NOSIGNAL);
+                    if (w <= 0) return;
+                    sent += w;
+                }
+            }
+        }
+    }
+
+    // Service mode: load the given pay files, then answer line-delimited
+    // queries over a UNIX domain socket, one thread per connection. The
+    // loaded state is read-only while serving, so connections share it
+    // without locking or copying. At most MAX_QUERY_CONNECTIONS are served
+    // at once; further clients wait in the listen backlog. Returns false
+    // if the socket cannot be set up or accepting fails for good.
+    bool serveQueries(const string& socketPath, const vector<string>& payFiles) {
+        if (!loadEmployees(FileNames::EMPLOYEES_FILE)) {
+            cout << "Cannot continue without employee records.\n";
+            return false;
+        }
+        for (const auto& fname : payFiles) {
+            vector<string> months;
+            loadPayFile(fname, months);
+            for (const auto& month : months)
+                cout << "File " << fname << " processed successfully as month " << month << ".\n";
+        }
+
+        int listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (listenFd < 0 || socketPath.size() >= sizeof(addr.sun_path)) {
+            cerr << "Error: Cannot create socket " << socketPath << endl;
+            if (listenFd >= 0) close(listenFd);
+            return false;
+        }
+        strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+        unlink(socketPath.c_str());
+        if (bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listenFd, SOMAXCONN) < 0) {
+            cerr << "Error: Cannot listen on " << socketPath << endl;
+            close(listenFd);
+            return false;
+        }
+        cout << "Serving payroll queries on " << socketPath << endl;
+
+        mutex connMutex;
+        condition_variable connDone;
+        size_t connections = 0;  // Connection threads still running
+        auto waitForConnections = [&](size_t below) {
+            unique_lock<mutex> lock(connMutex);
+            connDone.wait(lock, [&] { return connections < below; });
+        };
+        while (true) {
+            waitForConnections(Payroll::MAX_QUERY_CONNECTIONS);
+            int client = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                    // Out of descriptors or memory; give open connections time to finish
+                    poll(nullptr, 0, Payroll::ACCEPT_RETRY_MS);
+                    continue;
+                }
+                cerr << "Error: Cannot accept connections on " << socketPath << ": " << strerror(errno) << endl;
+                close(listenFd);
+                waitForConnections(1);  // The threads share this frame's counter
+                return false;
+            }
+            {
+                lock_guard<mutex> lock(connMutex);
+                ++connections;
+            }
+            thread([this, client, &connMutex, &connDone, &connections] {
+                serveConnection(client);
+                close(client);
+                lock_guard<mutex> lock(connMutex);
+                --connections;
+                connDone.notify_all();
+            }).detach();
+        }
+    }
+
+    // Shard that owns an employee ID
+    static size_t shardOf(const string& id, size_t shards) {
+        return hash<string>{}(id) % shards;
+    }
+
+    // A sharded run talks to each shard over a pair of pipes. The
+    // coordinator reads every pay file once and sends each shard these
+    // lines, with the records of the IDs it owns:
+    //   "F <file> <month>"              start of a month file
+    //   "L <file>"                      start of a long-format file
+    //   "R <record> <id> <hours> [<month>]"
+    //                                   a record and its position in its month;
+    //                                   long-format records carry their month
+    //   "D [<month>...]"                end of the file; a long-format file
+    //                                   lists the months to apply, in file order
+    //   "A"                             the file was unreadable or unchanged; drop it
+    //   "."                             end of the pay files
+    // The shard answers with the unknown IDs it was sent:
+    //   "E <file> <month> <record> <id>"  an unknown ID at a record position,
+    //                                   the month counted within the file
+    //   "?"                             end of the unknown IDs
+    // No shard holds the whole master, so the coordinator then asks every
+    // shard for its valid IDs nearest to each unknown one, and closes the
+    // shard's input:
+    //   "S <id>"                        an unknown ID to look up
+    // The shard streams back its suggestions and results:
+    //   "S <id> <edits> [<valid id>...]"  this shard's nearest valid IDs
+    //   "M <month>"                     start of a month's rows
+    //   "R <id>\t<report row>"          a report row, in ID order
+    //   "."                             end of the results
+
+    // How the coordinator got on with a pay file
+    enum class RouteResult { ROUTED, MISSING, UNREADABLE, INVALID_BINARY };
+
+    // Coordinator: read a pay file, telling its layout apart as
+    // readPayStream does, and send each record to the shard owning its ID.
+    // Files and months already processed with the same contents are
+    // skipped as a single-process run skips them, and the rest are
+    // recorded in the manifest. Long-format lines whose month is invalid
+    // are counted in invalidMonths.
+    RouteResult routePayFile(size_t file, const string& filename, const vector<ostream*>& shards,
+                             map<string, size_t>& invalidMonths) {
+        auto broadcast = [&](const string& line) {
+            for (ostream* s : shards) *s << line << '\n';
+        };
+        char hoursText[32];
+        auto send = [&](size_t record, const string& id, double hours, const string* month) {
+            snprintf(hoursText, sizeof(hoursText), "%.17g", hours);  // Round-trips exactly
+            ostream& s = *shards[shardOf(id, shards.size())];
+            s << "R " << record << ' ' << id << ' ' << hoursText;
+            if (month) s << ' ' << *month;
+            s << '\n';
+        };
+
+        FileFingerprint fp;  // Stat'ed before reading, as loadPayFile does
+        if (!ProcessedManifest::statFile(filename, fp)) return RouteResult::MISSING;
+        bool binary = BinaryPayFile::isBinaryFile(filename);
+        string month = monthFromFilename(filename);
+        if (binary && !BinaryPayFile::readMonth(filename, month)) return RouteResult::INVALID_BINARY;
+        if (manifest.knownContents(month, fp) && skipUnchangedPayFile(filename, month, fp)) return RouteResult::ROUTED;
+
+        // A month file's records are sent as they are read; whether the
+        // shards apply them is decided once the file's hash is known
+        size_t record = 0;
+        bool started = false;
+        auto startMonthFile = [&] {
+            if (!started) broadcast("F " + to_string(file) + " " + month);
+            started = true;
+        };
+        auto finishMonthFile = [&] {
+            startMonthFile();
+            fp.records = record;
+            if (skipUnchangedPayFile(filename, month, fp)) {
+                broadcast("A");
+                return;
+            }
+            broadcast("D");
+            loadedPayFiles.insert(month);
+            manifest.record(month, fp);
+        };
+        // Binary pay files are checked in full before any record is visited
+        auto routeBinaryRecord = [&](string&& id, double hours) {
+            startMonthFile();
+            send(record++, id, hours, nullptr);
+        };
+
+        if (binary) {
+            if (!BinaryPayFile::scan(filename, month, routeBinaryRecord, &fp.hash)) return RouteResult::INVALID_BINARY;
+            finishMonthFile();
+            return RouteResult::ROUTED;
+        }
+        InputFile fin(filename, true);
+        if (!fin) return RouteResult::MISSING;
+        string line;
+        getline(fin, line);
+        if (BinaryPayFile::isBinary(line.data(), line.size())) {
+            string content = move(line);
+            if (!fin.eof()) content += '\n';
+            appendStream(fin, content);
+            if (fin.readFailed()) return RouteResult::UNREADABLE;
+            if (!BinaryPayFile::forEachRecord(content.data(), content.size(), month, routeBinaryRecord))
+                return RouteResult::INVALID_BINARY;
+            fp.hash = fin.digest();
+            finishMonthFile();
+            return RouteResult::ROUTED;
+        }
+
+        while (trim(line).empty() && getline(fin, line)) {}
+        bool longFormat = isLongFormatLine(line);
+        if (longFormat) broadcast("L " + to_string(file));
+        else startMonthFile();
+        // Long format: each month's identity is the hash of its own records
+        struct MonthRecords {
+            size_t records = 0;
+            StreamHasher hasher;
+        };
+        map<string, MonthRecords> months;
+        vector<string> monthOrder;
+        do {
+            istringstream iss(line);
+            string id, lineMonth;
+            double hours;
+            if (!longFormat) {
+                if (iss >> id >> hours) send(record++, toUpper(trim(id)), hours, nullptr);
+                continue;
+            }
+            if (!(iss >> id >> lineMonth >> hours)) continue;  // Skip malformed lines
+            lineMonth = toUpper(trim(lineMonth));
+            if (monthPeriod(lineMonth) < 0) {
+                ++invalidMonths[lineMonth];
+                continue;
+            }
+            auto [it, added] = months.emplace(lineMonth, MonthRecords());
+            if (added) monthOrder.push_back(lineMonth);
+            id = toUpper(trim(id));
+            it->second.hasher.update(id.c_str(), id.size() + 1);
+            it->second.hasher.update(reinterpret_cast<const char*>(&hours), sizeof(hours));
+            send(it->second.records++, id, hours, &lineMonth);
+        } while (getline(fin, line));
+        if (fin.readFailed()) {
+            broadcast("A");
+            invalidMonths.clear();
+            return RouteResult::UNREADABLE;
+        }
+        fp.hash = fin.digest();
+        if (!longFormat) {
+            finishMonthFile();
+            return RouteResult::ROUTED;
+        }
+
+        string applied;
+        for (const auto& m : monthOrder) {
+            FileFingerprint monthFp = fp;
+            monthFp.hash = months[m].hasher.digest();
+            monthFp.records = months[m].records;
+            if (skipUnchangedPayFile(filename, m, monthFp)) continue;
+            applied += " " + m;
+            loadedPayFiles.insert(m);
+            manifest.record(m, monthFp);
+        }
+        broadcast("D" + applied);
+        return RouteResult::ROUTED;
+    }
+
+    // Shard worker: apply the records routed to this shard one pay file at
+    // a time, then stream the unknown IDs, suggestions and report rows back
+    bool runShard(const vector<string>& payFiles, istream& in, ostream& out) {
+        struct MonthRecords {
+            vector<PayRecord> records;
+            vector<size_t> positions;  // Each record's position in its month
+        };
+        map<string, MonthRecords> pending;  // The current file's records by month
+        vector<string> unknown;             // "E" lines
+        size_t file = payFiles.size();
+        string fileMonth;
+        bool longFormat = false;
+        string line;
+        while (getline(in, line) && line != ".") {
+            if (line.empty()) continue;
+            istringstream iss(line.substr(1));
+            if (line[0] == 'F' || line[0] == 'L') {
+                longFormat = line[0] == 'L';
+                if (!(iss >> file) || file >= payFiles.size() || (!longFormat && !(iss >> fileMonth))) return false;
+                pending.clear();
+            } else if (line[0] == 'R' && file < payFiles.size()) {
+                size_t record;
+                string id, hours, month = fileMonth;
+                if (!(iss >> record >> id >> hours) || (longFormat && !(iss >> month))) return false;
+                MonthRecords& mr = pending[month];
+                mr.records.push_back({id, strtod(hours.c_str(), nullptr)});
+                mr.positions.push_back(record);
+            } else if (line[0] == 'A') {
+                pending.clear();
+                file = payFiles.size();
+            } else if (line[0] == 'D' && file < payFiles.size()) {
+                vector<string> months;
+                if (longFormat) {
+                    for (string month; iss >> month; ) months.push_back(month);
+                } else {
+                    months.push_back(fileMonth);
+                }
+                for (size_t m = 0; m < months.size(); ++m) {
+                    const MonthRecords& mr = pending[months[m]];
+                    set<string> reported;
+                    for (size_t i = 0; i < mr.records.size(); ++i) {
+                        const string& id = mr.records[i].id;
+                        if (!employees.count(id) && (!aggregateShifts || reported.insert(id).second))
+                            unknown.push_back(to_string(file) + " " + to_string(m) + " " + to_string(mr.positions[i]) + " " + id);
+                    }
+                    clearLoadedMonth(months[m]);
+                    applyPayRecords(payFiles[file], months[m], mr.records);
+                    errors.clear();
+                }
+                pending.clear();
+                file = payFiles.size();
+            }
+        }
+
+        for (const auto& u : unknown) out << "E " << u << "\n";
+        out << "?\n";
+        if (!out.flush()) return false;
+
+        vector<string> queries;
+        while (getline(in, line))
+            if (line.compare(0, 2, "S ") == 0) queries.push_back(line.substr(2));
+        vector<IdSuggestion> near = suggestIds(queries);
+        for (size_t i = 0; i < queries.size(); ++i) {
+            out << "S " << queries[i] << ' ' << near[i].distance;
+            for (const auto& id : near[i].ids) out << ' ' << id;
+            out << "\n";
+        }
+        for (const auto& month : processedMonths) {
+            out << "M " << month << "\n";
+            for (const auto& [id, e] : employees) {
+                if (!e.hoursWorked.count(month)) continue;
+                out << "R " << id << '\t';
+                writeEmployeeRow(out, e, month);
+            }
+        }
+        out << ".\n";
+        return static_cast<bool>(out.flush());
+    }
+
+    // Coordinator mode: hash-partition employees by ID across shard worker
+    // processes, each running the normal compute logic on its slice. The
+    // coordinator reads each pay file once, routes the records by ID, and
+    // merges the shards' streamed rows into ID-ordered reports a month at
+    // a time, and their errors into errors.txt in file order, matching a
+    // single-process run byte for byte.
+    bool runSharded(size_t shards, const vector<string>& payFiles) {
+        if (shards == 0) {
+            cerr << "Error: Shard count must be at least 1" << endl;
+            return false;
+        }
+        cout.flush();
+        // A shard that exits early must fail the run, not kill it with SIGPIPE
+        signal(SIGPIPE, SIG_IGN);
+        struct Worker {
+            pid_t pid;
+            int records;  // Write end of the shard's input
+            int results;  // Read end of the shard's output
+        };
+        vector<Worker> workers;
+        for (size_t k = 0; k < shards; ++k) {
+            int in[2], out[2];
+            if (pipe2(in, O_CLOEXEC) != 0) break;
+            if (pipe2(out, O_CLOEXEC) != 0) {
+                close(in[0]);
+                close(in[1]);
+                break;
+            }
+            pid_t pid = fork();
+            if (pid == 0) {
+                // Holding another shard's input open would keep it waiting forever
+                for (const auto& w : workers) {
+                    close(w.records);
+                    close(w.results);
+                }
+                close(in[1]);
+                close(out[0]);
+                PayrollSystem worker;
+                worker.shardIndex = k;
+                worker.shardCount = shards;
+                worker.aggregateShifts = aggregateShifts;
+                worker.cumulativePaye = cumulativePaye;
+                FdInBuf inBuf(in[0]);
+                FdOutBuf outBuf(out[1]);
+                istream records(&inBuf);
+                ostream results(&outBuf);
+                bool ok = worker.loadEmployees(FileNames::EMPLOYEES_FILE) && worker.runShard(payFiles, records, results);
+                _exit(ok ? 0 : 1);
+            }
+            close(in[0]);
+            close(out[1]);
+            if (pid < 0) {
+                close(in[1]);
+                close(out[0]);
+                break;
+            }
+            workers.push_back({pid, in[1], out[0]});
+        }
+        bool ok = workers.size() == shards;
+
+        // Route every pay file's records, then end the shards' input
+        vector<RouteResult> routed(payFiles.size(), RouteResult::MISSING);
+        vector<map<string, size_t>> invalidMonths(payFiles.size());
+        if (ok) {
+            vector<unique_ptr<FdOutBuf>> bufs;
+            vector<unique_ptr<ostream>> streams;
+            vector<ostream*> to;
+            for (const auto& w : workers) {
+                bufs.push_back(make_unique<FdOutBuf>(w.records));
+                streams.push_back(make_unique<ostream>(bufs.back().get()));
+                to.push_back(streams.back().get());
+            }
+            for (size_t f = 0; f < payFiles.size(); ++f)
+                routed[f] = routePayFile(f, payFiles[f], to, invalidMonths[f]);
+            for (ostream* s : to) ok = (*s << ".\n").flush() && ok;
+        }
+
+        vector<unique_ptr<FdInBuf>> bufs;
+        vector<unique_ptr<istream>> results;
+        for (const auto& w : workers) {
+            bufs.push_back(make_unique<FdInBuf>(w.results));
+            results.push_back(make_unique<istream>(bufs.back().get()));
+        }
+        vector<string> head(workers.size());  // Each shard's next unread line
+        auto advance = [&](size_t k) {
+            if (!getline(*results[k], head[k])) head[k].clear();
+        };
+        // Between months every shard must be at the same "M" line or at "."
+        auto inStep = [&] {
+            if (head.empty() || (head[0] != "." && head[0].compare(0, 2, "M ") != 0)) return false;
+            return all_of(head.begin(), head.end(), [&](const string& h) { return h == head[0]; });
+        };
+
+        // Unknown IDs come first; (file, month, record) -> ID
+        map<tuple<size_t, size_t, size_t>, string> unknownIds;
+        for (size_t k = 0; ok && k < workers.size(); ++k) {
+            for (advance(k); head[k].compare(0, 2, "E ") == 0; advance(k)) {
+                istringstream iss(head[k].substr(2));
+                size_t file, month, record;
+                string id;
+                if (iss >> file >> month >> record >> id) unknownIds[{file, month, record}] = id;
+            }
+            ok = head[k] == "?";
+        }
+
+        // Every shard suggests its own nearest valid IDs; the closest win,
+        // in ID order, as if looked up in the whole master
+        map<string, IdSuggestion> suggestions;
+        for (const auto& entry : unknownIds) suggestions[entry.second];
+        if (ok) {
+            for (const auto& w : workers) {
+                FdOutBuf buf(w.records);
+                ostream queries(&buf);
+                for (const auto& entry : suggestions) queries << "S " << entry.first << "\n";
+                ok = queries.flush() && ok;
+            }
+        }
+        for (const auto& w : workers) close(w.records);
+        for (size_t k = 0; ok && k < workers.size(); ++k) {
+            for (advance(k); head[k].compare(0, 2, "S ") == 0; advance(k)) {
+                istringstream iss(head[k].substr(2));
+                string id;
+                IdSuggestion near;
+                if (!(iss >> id >> near.distance)) continue;
+                for (string valid; iss >> valid; ) near.ids.push_back(valid);
+                auto it = suggestions.find(id);
+                if (near.ids.empty() || it == suggestions.end()) continue;
+                IdSuggestion& best = it->second;
+                if (best.ids.empty() || near.distance < best.distance) {
+                    best = move(near);
+                } else if (near.distance == best.distance) {
+                    best.ids.insert(best.ids.end(), near.ids.begin(), near.ids.end());
+                    sort(best.ids.begin(), best.ids.end());
+                    if (best.ids.size() > Payroll::ID_SUGGESTION_LIMIT) best.ids.resize(Payroll::ID_SUGGESTION_LIMIT);
+                }
+            }
+        }
+        ok = ok && inStep();
+
+        // Errors in the order a single process would have logged them
+        for (size_t f = 0; ok && f < payFiles.size(); ++f) {
+            switch (routed[f]) {
+                case RouteResult::MISSING: reportMissingPayFile(payFiles[f]); continue;
+                case RouteResult::UNREADABLE: reportUnreadablePayFile(payFiles[f]); continue;
+                case RouteResult::INVALID_BINARY: reportInvalidBinaryPayFile(payFiles[f]); continue;
+                case RouteResult::ROUTED: break;
+            }
+            if (!invalidMonths[f].empty()) reportInvalidMonths(payFiles[f], invalidMonths[f]);
+            auto it = unknownIds.lower_bound({f, 0, 0});
+            while (it != unknownIds.end() && get<0>(it->first) == f) {
+                size_t month = get<1>(it->first);
+                for (; it != unknownIds.end() && get<0>(it->first) == f && get<1>(it->first) == month; ++it)
+                    errors.push_back({payFiles[f], unknownIdMessage(it->second, suggestions[it->second].ids)});
+                logErrors();
+            }
+        }
+
+        // Merge each month's ID-ordered rows as the shards stream them
+        auto idOf = [&](size_t k) { return head[k].find('\t'); };
+        while (ok && head[0] != ".") {
+            string month = head[0].substr(2);
+            string report;
+            {
+                ostringstream header;
+                printAlignedHeader(header);
+                report = header.str();
+            }
+            for (size_t k = 0; k < workers.size(); ++k) advance(k);
+            while (true) {
+                size_t best = workers.size();
+                for (size_t k = 0; k < workers.size(); ++k) {
+                    if (head[k].compare(0, 2, "R ") != 0 || idOf(k) == string::npos) continue;
+                    if (best == workers.size() || head[k].compare(2, idOf(k) - 2, head[best], 2, idOf(best) - 2) < 0)
+                        best = k;
+                }
+                if (best == workers.size()) break;
+                report.append(head[best], idOf(best) + 1, string::npos);
+                report += '\n';
+                advance(best);
+            }
+            if (!(ok = inStep())) break;  // A shard's results were cut short
+            cout << "Month " << month << " merged from " << shards << " shards.\n";
+            string fname = monthOutputName(month);
+            reportWriteResult(fname, saveMonthReport(fname, report));
+        }
+
+        for (const auto& w : workers) {
+            close(w.results);
+            int status = 0;
+            waitpid(w.pid, &status, 0);
+            ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        }
+        if (!ok) {
+            // The months routed were not all applied, so they stay unrecorded
+            cerr << "Error: A shard worker failed" << endl;
+            return false;
+        }
+        saveManifest();
+        return true;
+    }
+
+    // Process a pay file found by the directory watcher. Files whose
+    // contents match the manifest were handled by an earlier run and are
+    // skipped, unread if their size and modification time are unchanged.
+    // Under cumulative PAYE nothing is skipped, as later months' tax needs
+    // the earlier months' pay loaded.
+    void processWatchedFile(const string& path) {
+        vector<string> months;
+        loadPayFile(path, months, !cumulativePaye);
+        for (const auto& month : months) {
+            cout << "File " << path << " processed successfully as month " << month << ".\n";
+            writeMonthOutput(month);
+        }
+    }
+
+    // Daemon mode: watch a directory and process month pay files as they
+    // land. A file is picked up once it has been quiet for the debounce
+    // period, so partially written files are not read; a month that is
+    // already loaded is replaced. Files already in the directory are
+    // caught up on at startup.
+    bool watchDirectory(const string& dir) {
+        if (!loadEmployees(FileNames::EMPLOYEES_FILE)) {
+            cout << "Cannot continue without employee records.\n";
+            return false;
+        }
+        int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd < 0 || inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO) < 0) {
+            cerr << "Error: Cannot watch directory " << dir << endl;
+            if (fd >= 0) close(fd);
+            return false;
+        }
+        cout << "Watching " << dir << " for pay files\n";
+
+        if (DIR* d = opendir(dir.c_str())) {
+            vector<string> existing;
+            while (dirent* ent = readdir(d))
+                if (isPayFileName(ent->d_name)) existing.push_back(ent->d_name);
+            closedir(d);
+            sort(existing.begin(), existing.end());
+            for (const auto& name : existing) processWatchedFile(dir + "/" + name);
+        }
+
+        using Clock = chrono::steady_clock;
+        map<string, Clock::time_point> pending;  // File name -> last activity
+        alignas(inotify_event) char buf[4096];
+        while (true) {
+            pollfd pfd{fd, POLLIN, 0};
+            poll(&pfd, 1, pending.empty() ? -1 : Payroll::WATCH_DEBOUNCE_MS / 4);
+
+            ssize_t len;
+            while ((len = read(fd, buf, sizeof(buf))) > 0) {
+                for (char* p = buf; p < buf + len; ) {
+                    auto* ev = reinterpret_cast<inotify_event*>(p);
+                    if (ev->len > 0 && isPayFileName(ev->name)) pending[ev->name] = Clock::now();
+                    p += sizeof(inotify_event) + ev->len;
+                }
+            }
+
+            // Process files that have been quiet for the debounce period
+            auto now = Clock::now();
+            for (auto it = pending.begin(); it != pending.end(); ) {
+                if (now - it->second < chrono::milliseconds(Payroll::WATCH_DEBOUNCE_MS)) {
+                    ++it;
+                    continue;
+                }
+                processWatchedFile(dir + "/" + it->first);
+                it = pending.erase(it);
+            }
+        }
+    }
+
+    // Start reading and parsing a pay file on a worker thread
+    void startBackgroundLoad(const string& filename, const string& month, uintmax_t size) {
+        activeLoad = make_unique<BackgroundLoad>();
+        BackgroundLoad* job = activeLoad.get();
+        job->filename = filename;
+        job->month = month;
+        // A compressed file's size says little about how much text it holds
+        job->totalBytes = decompressorFor(filename) ? 0 : size;
+        job->started = chrono::steady_clock::now();
+        job->worker = thread([job] {
+            if (!ProcessedManifest::statFile(job->filename, job->fingerprint)) {
+                job->done = true;
+                return;
+            }
+            InputFile fin(job->filename, true);
+            if (fin) {
+                job->found = true;
+                job->contents.month = job->month;
+                job->valid = readPayStream(fin, job->contents, job);
+                job->fingerprint.hash = fin.digest();
+                job->complete = !fin.readFailed();
+            }
+            job->done = true;
+        });
+        cout << "Loading " << filename << " in the background. Choose option "
+             << Menu::LOAD_PROGRESS << " for progress or to cancel.\n";
+    }
+
+    // Describe how far the background load has got
+    string backgroundLoadProgress() const {
+        const BackgroundLoad& job = *activeLoad;
+        const double MB = 1024.0 * 1024.0;
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - job.started).count();
+        uint64_t bytes = job.bytesRead, lines = job.linesRead;
+        double linesPerSec = secs > 0 ? lines / secs : 0;
+        double bytesPerSec = secs > 0 ? bytes / secs : 0;
+        ostringstream out;
+        out << fixed << setprecision(1) << job.filename << ": " << bytes / MB;
+        if (job.totalBytes > 0) out << "/" << job.totalBytes / MB;
+        out << " MB, " << lines << " lines, " << setprecision(0) << linesPerSec << " lines/s";
+        if (bytesPerSec > 0 && job.totalBytes > bytes)
+            out << ", ETA " << (job.totalBytes - bytes) / bytesPerSec << "s";
+        return out.str();
+    }
+
+    // Apply a finished background load (or discard a cancelled one)
+    void finishBackgroundLoad() {
+        if (!activeLoad || !activeLoad->done) return;
+        unique_ptr<BackgroundLoad> job = move(activeLoad);
+        if (job->worker.joinable()) job->worker.join();
+        if (job->cancelled) {
+            cout << "Load of " << job->filename << " cancelled; month " << job->month << " was not changed.\n";
+        } else if (!job->found) {
+            reportMissingPayFile(job->filename);
+        } else if (!job->complete) {
+            reportUnreadablePayFile(job->filename);
+        } else if (!job->valid) {
+            reportInvalidBinaryPayFile(job->filename);
+        } else {
+            for (const auto& month : applyPayFileContents(job->filename, job->contents, job->fingerprint)) {
+                cout << "File " << job->filename << " processed successfully as month " << month << ".\n";
+                writeMonthOutput(month);
+            }
+        }
+    }
+
+    // Show a live progress line for the background load, with cancellation
+    void loadProgressMenu() {
+        if (!activeLoad) {
+            cout << "No pay file is loading.\n";
+            return;
+        }
+        cout << "Press Enter to return, or type '" << Inputs::CANCEL << "' and Enter to cancel the load.\n";
+        while (!activeLoad->done) {
+            cout << "\r" << backgroundLoadProgress() << "    " << flush;
+            pollfd pfd{STDIN_FILENO, POLLIN, 0};
+            if (poll(&pfd, 1, Payroll::PROGRESS_REFRESH_MS) > 0) {
+                string input = toLower(trim(getStringInput("")));
+                if (input == Inputs::CANCEL) {
+                    activeLoad->cancelled = true;
+                    activeLoad->worker.join();
+                }
+                break;
+            }
+        }
+        cout << "\n";
+        finishBackgroundLoad();
+    }
+
+    // Convert a text pay file to the binary fixed-record format
+    static bool convertPayFileToBinary(const string& textFile, const string& binaryFile) {
+        InputFile fin(textFile);
+        if (!fin) {
+            cerr << "Error: Could not open " << textFile << endl;
+            return false;
+        }
+        vector<PayRecord> records;
+        parsePayRecords(fin, records);
+        if (fin.readFailed()) {
+            cerr << "Error: Could not read all of " << textFile << endl;
+            return false;
+        }
+        if (!BinaryPayFile::write(binaryFile, monthFromFilename(textFile), records)) {
+            cerr << "Error: Cannot write " << binaryFile << " (IDs must be at most 16 characters)" << endl;
+            return false;
+        }
+        cout << "Wrote " << records.size() << " records to " << binaryFile << endl;
+        return true;
+    }
+
     // Main program loop
     void run() {
         cout << "Welcome to the Payroll System\n";
@@ -502,6 +4218,8 @@ public:
 
         int choice = Menu::INVALID_CHOICE;
         while (choice != Menu::QUIT) {
+            finishBackgroundLoad();
+
             // Display main menu
             printLine(LINE_TOTAL_WIDTH);
             cout << "Main Menu:\n";
@@ -511,10 +4229,13 @@ public:
             cout << Menu::VIEW_INDIVIDUAL << ". View Individual Employee Details\n";
             cout << Menu::SORT_EMPLOYEES << ". Sort Employees\n";
             cout << Menu::VIEW_EMPLOYEE_TOTALS << ". View Employee Totals\n";
+            cout << Menu::LOAD_PROGRESS << ". Load Progress / Cancel\n";
+            cout << Menu::RELOAD_EMPLOYEES << ". Reload Employee Master\n";
             cout << Menu::QUIT << ". Quit\n";
             printShortLine(LINE_TOTAL_WIDTH);
+            if (activeLoad) cout << "Loading " << backgroundLoadProgress() << "\n";
 
-            choice = getIntInput(Menu::QUIT, Menu::VIEW_EMPLOYEE_TOTALS, "Enter choice: ");
+            choice = getIntInput(Menu::QUIT, Menu::RELOAD_EMPLOYEES, "Enter choice: ");
 
             // Handle menu selection
             switch (choice) {
@@ -523,6 +4244,8 @@ public:
                 case Menu::VIEW_INDIVIDUAL: showEmployeeBreakdown(); break;
                 case Menu::SORT_EMPLOYEES: sortEmployeesMenu(); break;
                 case Menu::VIEW_EMPLOYEE_TOTALS: showEmployeeTotals(); break;
+                case Menu::LOAD_PROGRESS: loadProgressMenu(); break;
+                case Menu::RELOAD_EMPLOYEES: reloadEmployees(FileNames::EMPLOYEES_FILE); break;
                 case Menu::QUIT: cout << "Goodbye!\n"; break;
                 default: cout << "Invalid choice. Try again.\n";
             }
@@ -532,10 +4255,39 @@ public:
     // Menu for processing pay files
     void processPayFileMenu() {
         while (true) {
-            string fname = getStringInput("Enter pay file to process (e.g., jan25.txt), or '0' to return: ");
+            string fname = getStringInput("Enter pay file(s) to process (e.g., jan25.txt feb25.txt), or '0' to return: ");
             if (fname == Inputs::RETURN) return;
-            string month;
-            if (loadPayFile(fname, month)) {
+
+            // Several files at once go through the overlapped pipeline
+            istringstream iss(fname);
+            vector<string> batch;
+            for (string f; iss >> f; ) batch.push_back(f);
+            if (batch.size() > 1) {
+                processPayFilesPipelined(batch);
+                continue;
+            }
+
+            // Large files load on a worker so the menu stays usable
+            struct stat st;
+            if (stat(fname.c_str(), &st) == 0 && static_cast<uintmax_t>(st.st_size) >= Payroll::BACKGROUND_LOAD_MIN_BYTES
+                && !BinaryPayFile::isBinaryFile(fname)) {
+                string month = monthFromFilename(fname);
+                FileFingerprint fp;
+                if (ProcessedManifest::statFile(fname, fp) && manifest.knownContents(month, fp)
+                    && skipUnchangedPayFile(fname, month, fp)) continue;
+                finishBackgroundLoad();
+                if (activeLoad) {
+                    cout << "Another pay file is still loading. Wait for it or cancel it first.\n";
+                    continue;
+                }
+                startBackgroundLoad(fname, month, st.st_size);
+                return;
+            }
+
+            // A long-format file may hold several months
+            vector<string> months;
+            loadPayFile(fname, months);
+            for (const auto& month : months) {
                 cout << "File " << fname << " processed successfully as month " << month << ".\n";
                 writeMonthOutput(month);  // Create output file automatically
             }
@@ -564,15 +4316,6 @@ public:
 
     // Menu for sorting employees by various criteria
     void sortEmployeesMenu() {
-        // Column width constants
-        const int w_id    = 8;
-        const int w_name  = 18;
-        const int w_rate  = 10;
-        const int w_hours = 8;
-        const int w_gross = 12;
-        const int w_tax   = 10;
-        const int w_net   = 12;
-
         if (processedMonths.empty()) {
             cout << "No pay files processed yet.\n";
             return;
@@ -596,50 +4339,71 @@ public:
         cout << Payroll::SORT_NET_PAY << ". Net Pay\n";
         int crit = getIntInput(Payroll::SORT_HOURLY_RATE, Payroll::SORT_NET_PAY, "Enter choice: ");
 
-        // Build list of employees who worked in selected month
-        vector<Employee> emps;
-        for (const auto& pair : employees)
-            if (pair.second.hoursWorked.count(month))
-                emps.push_back(pair.second);
+        // Feed compact (key, ID) pairs for the selected month to the sorter
+        ExternalSorter sorter(sortBudget);
+        for (const auto& [id, e] : employees) {
+            auto hrs = e.hoursWorked.find(month);
+            if (hrs == e.hoursWorked.end()) continue;
+            switch (crit) {
+                case Payroll::SORT_HOURLY_RATE: sorter.add(e.rateFor(month), id); break;
+                case Payroll::SORT_HOURS_WORKED: sorter.add(hrs->second, id); break;
+                case Payroll::SORT_NET_PAY: sorter.add(e.getNetPay(month), id); break;
+            }
+        }
 
         // Display header
         printShortLine(HEADER_TOTAL_WIDTH);
         printAlignedHeader(cout);
         printShortLine(HEADER_TOTAL_WIDTH);
 
-        // Sort employees based on selected criteria (descending order)
-        switch (crit) {
-            case Payroll::SORT_HOURLY_RATE:
-                sort(emps.begin(), emps.end(), [](const Employee& a, const Employee& b) {
-                    return a.hourlyRate > b.hourlyRate;
-                }); break;
-            case Payroll::SORT_HOURS_WORKED:
-                sort(emps.begin(), emps.end(), [month](const Employee& a, const Employee& b) {
-                    return a.hoursWorked.at(month) > b.hoursWorked.at(month);
-                }); break;
-            case Payroll::SORT_NET_PAY:
-                sort(emps.begin(), emps.end(), [month](const Employee& a, const Employee& b) {
-                    return a.getNetPay(month) > b.getNetPay(month);
-                }); break;
-        }
-
-        // Display sorted results
-        for (const auto& e : emps) {
-            cout << left << setw(w_id) << e.id
-                 << left << setw(w_name) << e.name
-                 << right << setw(w_rate) << fixed << setprecision(2) << e.hourlyRate
-                 << right << setw(w_hours) << fixed << setprecision(2) << e.hoursWorked.at(month)
-                 << right << setw(w_gross) << fixed << setprecision(2) << e.getGrossPay(month)
-                 << right << setw(w_tax) << fixed << setprecision(2) << e.getTax(month)
-                 << right << setw(w_net) << fixed << setprecision(2) << e.getNetPay(month) << endl;
-        }
+        // Display sorted results (descending order)
+        sorter.forEachSorted([&](const ExternalSorter::Record& r) {
+            writeEmployeeRow(cout, employees.at(r.id), month);
+        });
         printLine(HEADER_TOTAL_WIDTH);
     }
 };
 
 // =============== Program Entry Point ===============
-int main() {
+int main(int argc, char* argv[]) {
     PayrollSystem sys;
+
+    // Settings come first, followed by an optional mode
+    int arg = 1;
+    while (arg < argc) {
+        if (argv[arg] == Options::COMPRESS_OUTPUT && arg + 1 < argc) {
+            if (!sys.setOutputCompression(argv[arg + 1])) {
+                cerr << "Error: Unsupported output compression " << argv[arg + 1] << endl;
+                return 1;
+            }
+            arg += 2;
+        } else if (argv[arg] == Options::SORT_BUDGET && arg + 1 < argc) {
+            if (!sys.setSortBudget(argv[arg + 1])) {
+                cerr << "Error: Invalid sort budget " << argv[arg + 1] << endl;
+                return 1;
+            }
+            arg += 2;
+        } else if (argv[arg] == Options::AGGREGATE_SHIFTS) {
+            sys.setAggregateShifts(true);
+            ++arg;
+        } else if (argv[arg] == Options::CUMULATIVE_PAYE) {
+            sys.setCumulativePaye(true);
+            ++arg;
+        } else {
+            break;
+        }
+    }
+    int remaining = argc - arg;
+    char** mode = argv + arg;
+
+    if (remaining >= 3 && mode[0] == Options::TO_BINARY)
+        return PayrollSystem::convertPayFileToBinary(mode[1], mode[2]) ? 0 : 1;
+    if (remaining >= 2 && mode[0] == Options::SHARDS)
+        return sys.runSharded(strtoul(mode[1], nullptr, 10), vector<string>(mode + 2, mode + remaining)) ? 0 : 1;
+    if (remaining >= 2 && mode[0] == Options::WATCH)
+        return sys.watchDirectory(mode[1]) ? 0 : 1;
+    if (remaining >= 2 && mode[0] == Options::SERVE)
+        return sys.serveQueries(mode[1], vector<string>(mode + 2, mode + remaining)) ? 0 : 1;
     sys.run();
     return 0;
 }
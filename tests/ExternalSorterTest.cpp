@@ -0,0 +1,72 @@
+// ExternalSorter test: a tiny memory budget forces several spilled runs,
+// and the merged output must match an in-memory sort while the buffer,
+// counted by its capacity, never grows much past the budget.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -pthread tests/ExternalSorterTest.cpp -o sorter_test && ./sorter_test
+
+#define main payrollMain
+#include "../PayrollSystem.cpp"
+#undef main
+
+static int failures = 0;
+
+static void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+int main() {
+    const size_t budget = 1024;
+    const size_t count = 5000;
+    ExternalSorter sorter(budget);
+    vector<ExternalSorter::Record> expected;
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < count; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        double key = static_cast<double>((seed >> 8) % 100) / 4.0;  // Plenty of ties
+        string id = "E" + to_string(count - i);
+        sorter.add(key, id);
+        expected.push_back({key, id});
+    }
+    sort(expected.begin(), expected.end(), [](const ExternalSorter::Record& a, const ExternalSorter::Record& b) {
+        if (a.key != b.key) return a.key > b.key;
+        return a.id < b.id;
+    });
+
+    check(sorter.runCount() > 2, "several runs spilled (got " + to_string(sorter.runCount()) + ")");
+    // Buffered bytes include the buffer's whole capacity. The buffer only
+    // grows as far as the budget allows and spills as soon as it reaches
+    // it, so it never holds more than the budget plus the record that
+    // crossed it
+    size_t recordLimit = sizeof(ExternalSorter::Record) + 32;
+    check(sorter.peakBufferedBytes() >= budget, "buffer filled to the budget before spilling");
+    check(sorter.peakBufferedBytes() < budget + recordLimit,
+          "peak buffer " + to_string(sorter.peakBufferedBytes()) + " within budget " + to_string(budget));
+
+    vector<ExternalSorter::Record> merged;
+    bool complete = sorter.forEachSorted([&](const ExternalSorter::Record& r) { merged.push_back(r); });
+    check(complete, "merge reports success");
+    check(merged.size() == expected.size(), "every record visited once");
+    for (size_t i = 0; i < min(merged.size(), expected.size()); ++i) {
+        if (merged[i].key != expected[i].key || merged[i].id != expected[i].id) {
+            check(false, "merged order differs at position " + to_string(i));
+            break;
+        }
+    }
+
+    // A sorter that never reaches its budget sorts in memory
+    ExternalSorter small(budget);
+    small.add(1.0, "B");
+    small.add(2.0, "C");
+    small.add(1.0, "A");
+    string order;
+    small.forEachSorted([&](const ExternalSorter::Record& r) { order += r.id; });
+    check(small.runCount() == 0 && order == "CAB", "in-memory sort order (got " + order + ")");
+
+    if (failures) return 1;
+    cout << "ExternalSorter tests passed" << endl;
+    return 0;
+}
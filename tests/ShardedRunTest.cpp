@@ -0,0 +1,116 @@
+// Sharded run test: a batch with a resubmitted month file must leave the
+// same error log, reports and manifest whether it runs through the menu in
+// one process or through --shards.
+//
+// Build and run from the repository root:
+//   g++ -std=c++17 -O2 -pthread tests/ShardedRunTest.cpp -o sharded_test && ./sharded_test
+
+#define main payrollMain
+#include "../PayrollSystem.cpp"
+#undef main
+
+static int failures = 0;
+
+static void check(bool condition, const string& what) {
+    if (!condition) {
+        cerr << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+static void writeFile(const string& path, const string& contents) {
+    ofstream out(path);
+    out << contents;
+}
+
+static string readFile(const string& path) {
+    ifstream in(path);
+    stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+// Manifest pay lines without the modification time, which differs between runs
+static string manifestPayLines(const string& path) {
+    ifstream in(path);
+    string line, result;
+    while (getline(in, line)) {
+        stringstream ss(line);
+        string kind, month, size, mtime, rest;
+        ss >> kind >> month >> size >> mtime;
+        getline(ss, rest);
+        if (kind == "pay") result += month + " " + size + rest + "\n";
+    }
+    return result;
+}
+
+static string makeRunDir(const string& root, const string& name) {
+    string dir = root + "/" + name;
+    mkdir(dir.c_str(), 0700);
+    writeFile(dir + "/" + FileNames::EMPLOYEES_FILE,
+              "AB101 JSmith 12.50\nCD202 KJones 15.00\nEF303 LBrown 22.75\nGH404 MWhite 9.80\n");
+    writeFile(dir + "/Jan25.txt", "AB101 160.0\nCD202 120.5\nZZ999 40.0\nEF303 175.0\n");
+    writeFile(dir + "/Feb25.txt", "AB101 150.0\nCD202 130.0\nEF303 168.0\nGH404 80.0\nYY888 12.0\n");
+    return dir;
+}
+
+int main() {
+    char root[] = "/tmp/sharded_testXXXXXX";
+    if (!mkdtemp(root)) {
+        cerr << "Cannot create a temporary directory" << endl;
+        return 1;
+    }
+    char cwd[PATH_MAX];
+    if (!getcwd(cwd, sizeof(cwd))) return 1;
+    const vector<string> batch = {"Jan25.txt", "Feb25.txt", "Feb25.txt"};
+    streambuf* savedOut = cout.rdbuf();
+    stringstream discard;
+
+    // One process: the whole batch on one menu line runs the pipelined path
+    string single = makeRunDir(root, "single");
+    if (chdir(single.c_str()) != 0) return 1;
+    {
+        istringstream menu("1\nJan25.txt Feb25.txt Feb25.txt\n0\n0\n");
+        streambuf* savedIn = cin.rdbuf(menu.rdbuf());
+        cout.rdbuf(discard.rdbuf());
+        PayrollSystem sys;
+        sys.run();
+        cout.flush();
+        cout.rdbuf(savedOut);
+        cin.rdbuf(savedIn);
+    }
+
+    string sharded = makeRunDir(root, "sharded");
+    if (chdir(sharded.c_str()) != 0) return 1;
+    {
+        cout.rdbuf(discard.rdbuf());
+        PayrollSystem sys;
+        bool ok = sys.runSharded(2, batch);
+        cout.flush();
+        cout.rdbuf(savedOut);
+        check(ok, "sharded run succeeds");
+    }
+    if (chdir(cwd) != 0) return 1;
+
+    string singleErrors = readFile(single + "/" + FileNames::ERROR_LOG_FILE);
+    check(!singleErrors.empty(), "unknown IDs are logged");
+    check(readFile(sharded + "/" + FileNames::ERROR_LOG_FILE) == singleErrors, "error logs match");
+    for (const char* report : {"jan25", "feb25"}) {
+        string name = string(report) + FileNames::OUTPUT_SUFFIX;
+        string expected = readFile(single + "/" + name);
+        check(!expected.empty(), name + " written by the single run");
+        check(readFile(sharded + "/" + name) == expected, name + " matches");
+    }
+    string singleManifest = manifestPayLines(single + "/" + FileNames::MANIFEST_FILE);
+    check(singleManifest.find("JAN25") != string::npos && singleManifest.find("FEB25") != string::npos,
+          "both months recorded in the manifest");
+    check(manifestPayLines(sharded + "/" + FileNames::MANIFEST_FILE) == singleManifest, "manifests match");
+
+    if (failures) {
+        cerr << "Run directories kept in " << root << endl;
+        return 1;
+    }
+    system(("rm -rf " + string(root)).c_str());
+    cout << "Sharded run tests passed" << endl;
+    return 0;
+}